@@ -3,13 +3,22 @@
 // 作者：289371298 upgraded from zhouhy
 // https://www.botzone.org.cn/games/Tank2
 
-#include <stack>
 #include <set>
 #include <string>
 #include <iostream>
 #include <ctime>
 #include <cstring>
+#include <memory>
 #include <queue>
+#include <random>
+#include <type_traits>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 #ifdef _BOTZONE_ONLINE
 #include "jsoncpp/json.h"
 #else
@@ -33,7 +42,6 @@ using std::make_pair;
 
 namespace TankGame
 {
-    using std::stack;
     using std::set;
     using std::istream;
 
@@ -41,6 +49,7 @@ namespace TankGame
 #pragma region 常量定义和说明
 #endif
 
+    // 其余取值为获胜方的编号
     enum GameResult
     {
         NotFinished = -2,
@@ -49,6 +58,7 @@ namespace TankGame
         Red = 1
     };
 
+    // 每方超过 2 个坦克或多于 2 方时，第 5 个起的坦克依次使用 Water 之后的位（见 FieldSize::TankItem）
     enum FieldItem
     {
         None = 0,
@@ -62,6 +72,15 @@ namespace TankGame
         Water = 128
     };
 
+    // 游戏结束的原因，可能同时有多个
+    enum GameEndReason
+    {
+        NotEnded = 0,
+        BaseDestroyed = 1, // 有一方的基地被炸
+        TanksDestroyed = 2, // 有一方的坦克全炸
+        TurnLimit = 4 // 到达回合上限时仍有多方存活
+    };
+
     template<typename T> inline T operator~ (T a) { return (T)~(int)a; }
     template<typename T> inline T operator| (T a, T b) { return (T)((int)a | (int)b); }
     template<typename T> inline T operator& (T a, T b) { return (T)((int)a & (int)b); }
@@ -82,21 +101,21 @@ namespace TankGame
     // Side（对战双方） - 0 为蓝，1 为红
     // Tank（每方的坦克） - 0 为 0 号坦克，1 为 1 号坦克
     // Turn（回合编号） - 从 1 开始
+    // 场地大小、方数和每方坦克数是下面各个类的模板参数（见 FieldSize），Botzone 上的规模见“默认规模”一节
 
-    const int fieldHeight = 9, fieldWidth = 9, sideCount = 2, tankPerSide = 2;
-
-    // 基地的横坐标
-    const int baseX[sideCount] = { fieldWidth / 2, fieldWidth / 2 };
+    constexpr int dx[4] = { 0, 1, 0, -1 }, dy[4] = { -1, 0, 1, 0 };
 
-    // 基地的纵坐标
-    const int baseY[sideCount] = { 0, fieldHeight - 1 };
+    int maxTurn = 100;
 
-    const int dx[4] = { 0, 1, 0, -1 }, dy[4] = { -1, 0, 1, 0 };
-    const FieldItem tankItemTypes[sideCount][tankPerSide] = {
-        { Blue0, Blue1 },{ Red0, Red1 }
-    };
+    // 回合数的上限，决定按回合记录的数组大小（maxTurn 不应超过它）
+    const int turnCapacity = 100;
 
-    int maxTurn = 100;
+    // TankField 是否保存整局的动作历史；定义 TANK2_RULES_ONLY_HISTORY 时只保存上一回合（规则只用到上一回合）
+#ifdef TANK2_RULES_ONLY_HISTORY
+    const bool fullActionHistory = false;
+#else
+    const bool fullActionHistory = true;
+#endif
 
 #ifdef _MSC_VER
 #pragma endregion
@@ -119,11 +138,6 @@ namespace TankGame
         return a >= Up && b >= Up && (a + 2) % 4 == b % 4;
     }
 
-    inline bool CoordValid(int x, int y)
-    {
-        return x >= 0 && x < fieldWidth && y >= 0 && y < fieldHeight;
-    }
-
     // 判断 item 是不是叠在一起的多个坦克
     inline bool HasMultipleTank(FieldItem item)
     {
@@ -132,472 +146,3479 @@ namespace TankGame
         return !!(item & (item - 1));
     }
 
-    inline int GetTankSide(FieldItem item)
+    // 获得动作的方向
+    inline int ExtractDirectionFromAction(Action x)
     {
-        return item == Blue0 || item == Blue1 ? Blue : Red;
+        if (x >= Up)
+            return x % 4;
+        return -1;
     }
 
-    inline int GetTankID(FieldItem item)
+    // 最低 / 最高的 1 所在的位，x 不能为 0
+    inline int LowestBitIndex(unsigned long long x)
     {
-        return item == Blue0 || item == Red0 ? 0 : 1;
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return (int)index;
+#else
+        return __builtin_ctzll(x);
+#endif
     }
 
-    // 获得动作的方向
-    inline int ExtractDirectionFromAction(Action x)
+    inline int HighestBitIndex(unsigned long long x)
     {
-        if (x >= Up)
-            return x % 4;
-        return -1;
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, x);
+        return (int)index;
+#else
+        return 63 - __builtin_clzll(x);
+#endif
     }
 
-    // 物件消失的记录，用于回退
-    struct DisappearLog
+    // 物件消失的记录，用于回退（每回合的记录从 TankField::logStart 开始，不需要记回合）
+    // 只存物件的位序号和格子编号，默认规模下每条 2 个字节
+    template<typename Size>
+    struct BasicDisappearLog
     {
-        FieldItem item;
+        // 物件在 FieldItem 中的位序号
+        unsigned char itemIndex;
 
-        // 导致其消失的回合的编号
-        int turn;
+        typename Size::CellType cell;
 
-        int x, y;
-        bool operator< (const DisappearLog& b) const
+        static BasicDisappearLog Make(FieldItem item, int cell)
         {
-            if (x == b.x)
-            {
-                if (y == b.y)
-                    return item < b.item;
-                return y < b.y;
-            }
-            return x < b.x;
+            BasicDisappearLog log;
+            log.itemIndex = (unsigned char)LowestBitIndex(item);
+            log.cell = (typename Size::CellType)cell;
+            return log;
         }
-    };
 
-#ifdef _MSC_VER
-#pragma endregion
+        FieldItem Item() const
+        {
+            return (FieldItem)(1 << itemIndex);
+        }
 
-#pragma region TankField 主要逻辑类
-#endif
+        int X() const
+        {
+            return Size::CellX(cell);
+        }
+
+        int Y() const
+        {
+            return Size::CellY(cell);
+        }
+    };
 
-    class TankField
+    // 位棋盘，第 CellIndex(x, y) 位表示格子 (x, y)，共 Cells 个格子
+    // 保持为 POD，可以直接 memcpy
+    template<int Cells>
+    struct BasicBitboard
     {
-    public:
-        //!//!//!// 以下变量设计为只读，不推荐进行修改 //!//!//!//
+        static const int wordCount = (Cells + 63) / 64;
 
-        // 游戏场地上的物件（一个格子上可能有多个坦克）
-        FieldItem gameField[fieldHeight][fieldWidth] = {};
+        unsigned long long word[wordCount];
 
-        // 坦克是否存活
-        bool tankAlive[sideCount][tankPerSide] = { { true, true },{ true, true } };
+        static BasicBitboard Cell(int cell)
+        {
+            BasicBitboard b = {};
+            b.word[cell >> 6] = 1ULL << (cell & 63);
+            return b;
+        }
 
-        // 基地是否存活
-        bool baseAlive[sideCount] = { true, true };
+        bool Test(int cell) const
+        {
+            return (word[cell >> 6] >> (cell & 63)) & 1;
+        }
 
-        // 坦克横坐标，-1表示坦克已炸
-        int tankX[sideCount][tankPerSide] = {
-            { fieldWidth / 2 - 2, fieldWidth / 2 + 2 },{ fieldWidth / 2 + 2, fieldWidth / 2 - 2 }
-        };
+        void Set(int cell)
+        {
+            word[cell >> 6] |= 1ULL << (cell & 63);
+        }
 
-        // 坦克纵坐标，-1表示坦克已炸
-        int tankY[sideCount][tankPerSide] = { { 0, 0 },{ fieldHeight - 1, fieldHeight - 1 } };
+        void Reset(int cell)
+        {
+            word[cell >> 6] &= ~(1ULL << (cell & 63));
+        }
 
-        // 当前回合编号
-        int currentTurn = 1;
+        bool Any() const
+        {
+            unsigned long long acc = 0;
+            for (int i = 0; i < wordCount; i++)
+                acc |= word[i];
+            return acc != 0;
+        }
 
-        // 我是哪一方
-        int mySide;
+        // 编号最小的格子，没有则返回 -1
+        int Lowest() const
+        {
+            for (int i = 0; i < wordCount; i++)
+                if (word[i])
+                    return i * 64 + LowestBitIndex(word[i]);
+            return -1;
+        }
 
-        // 用于回退的log
-        stack<DisappearLog> logs;
+        // 编号最大的格子，没有则返回 -1
+        int Highest() const
+        {
+            for (int i = wordCount - 1; i >= 0; i--)
+                if (word[i])
+                    return i * 64 + HighestBitIndex(word[i]);
+            return -1;
+        }
 
-        // 过往动作（previousActions[x] 表示所有人在第 x 回合的动作，第 0 回合的动作没有意义）
-        Action previousActions[101][sideCount][tankPerSide] = { { { Stay, Stay },{ Stay, Stay } } };
+        // 取出编号最小的格子并将其清除，不能为空
+        int PopLowest()
+        {
+            int i = 0;
+            while (!word[i])
+                i++;
+            int cell = i * 64 + LowestBitIndex(word[i]);
+            word[i] &= word[i] - 1;
+            return cell;
+        }
 
-        //!//!//!// 以上变量设计为只读，不推荐进行修改 //!//!//!//
+        BasicBitboard operator& (const BasicBitboard& b) const
+        {
+            BasicBitboard r;
+            for (int i = 0; i < wordCount; i++)
+                r.word[i] = word[i] & b.word[i];
+            return r;
+        }
 
-        // 本回合双方即将执行的动作，需要手动填入
-        Action nextAction[sideCount][tankPerSide] = { { Invalid, Invalid },{ Invalid, Invalid } };
+        BasicBitboard operator| (const BasicBitboard& b) const
+        {
+            BasicBitboard r;
+            for (int i = 0; i < wordCount; i++)
+                r.word[i] = word[i] | b.word[i];
+            return r;
+        }
 
-        // 判断行为是否合法（出界或移动到非空格子算作非法）
-        // 未考虑坦克是否存活
-        bool ActionIsValid(int side, int tank, Action act)
+        BasicBitboard operator^ (const BasicBitboard& b) const
         {
-            if (act == Invalid)
-                return false;
-            if (act > Left && previousActions[currentTurn - 1][side][tank] > Left) // 连续两回合射击
-                return false;
-            if (act == Stay || act > Left)
-                return true;
-            int x = tankX[side][tank] + dx[act],
-                y = tankY[side][tank] + dy[act];
-            return CoordValid(x, y) && gameField[y][x] == None;// water cannot be stepped on
+            BasicBitboard r;
+            for (int i = 0; i < wordCount; i++)
+                r.word[i] = word[i] ^ b.word[i];
+            return r;
         }
 
-        // 判断 nextAction 中的所有行为是否都合法
-        // 忽略掉未存活的坦克
-        bool ActionIsValid()
+        // 去掉 b 中的格子
+        BasicBitboard operator- (const BasicBitboard& b) const
         {
-            for (int side = 0; side < sideCount; side++)
-                for (int tank = 0; tank < tankPerSide; tank++)
-                    if (tankAlive[side][tank] && !ActionIsValid(side, tank, nextAction[side][tank]))
-                        return false;
-            return true;
+            BasicBitboard r;
+            for (int i = 0; i < wordCount; i++)
+                r.word[i] = word[i] & ~b.word[i];
+            return r;
         }
 
-    private:
-        void _destroyTank(int side, int tank)
+        BasicBitboard& operator&= (const BasicBitboard& b) { return *this = *this & b; }
+        BasicBitboard& operator|= (const BasicBitboard& b) { return *this = *this | b; }
+        BasicBitboard& operator^= (const BasicBitboard& b) { return *this = *this ^ b; }
+        BasicBitboard& operator-= (const BasicBitboard& b) { return *this = *this - b; }
+
+        bool operator== (const BasicBitboard& b) const
         {
-            tankAlive[side][tank] = false;
-            tankX[side][tank] = tankY[side][tank] = -1;
+            for (int i = 0; i < wordCount; i++)
+                if (word[i] != b.word[i])
+                    return false;
+            return true;
         }
 
-        void _revertTank(int side, int tank, DisappearLog& log)
+        bool operator!= (const BasicBitboard& b) const
         {
-            int &currX = tankX[side][tank], &currY = tankY[side][tank];
-            if (tankAlive[side][tank])
-                gameField[currY][currX] &= ~tankItemTypes[side][tank];
-            else
-                tankAlive[side][tank] = true;
-            currX = log.x;
-            currY = log.y;
-            gameField[currY][currX] |= tankItemTypes[side][tank];
+            return !(*this == b);
         }
-    public:
+    };
 
-        // 执行 nextAction 中指定的行为并进入下一回合，返回行为是否合法
-        bool DoAction()
+    // 射线是否朝格子编号增大的方向延伸（右、下），决定取最低位还是最高位作为第一个障碍
+    const bool rayAscending[4] = { false, true, true, false };
+
+    // 每个格子向四个方向的射线（不含自身，直到边界），编译期生成
+    template<int Height, int Width>
+    struct BasicRayTable
+    {
+        static const int cellCount = Height * Width;
+
+        // 射线上最多的格子数
+        static const int maxRayLength = (Height > Width ? Height : Width) - 1;
+
+        typedef BasicBitboard<cellCount> Bitboard;
+
+        // 格子编号的类型（-1 表示没有格子），默认规模下为一个字节
+        typedef typename std::conditional<(cellCount <= 128), signed char, short>::type CellType;
+
+        // 射线上的所有格子
+        Bitboard ray[cellCount][4];
+
+        // 相邻的一格（出界则为空）
+        Bitboard step[cellCount][4];
+
+        // 相邻格子的编号，出界为 -1
+        int neighbor[cellCount][4];
+
+        // 射线上的格子编号，由近及远，不足 maxRayLength 的部分为 -1
+        struct CellList
         {
-            if (!ActionIsValid())
-                return false;
+            CellType cell[maxRayLength];
+        } cells[cellCount][4];
 
-            // 1 移动
-            for (int side = 0; side < sideCount; side++)
-                for (int tank = 0; tank < tankPerSide; tank++)
-                {
-                    Action act = nextAction[side][tank];
+        // 射线上的格子数
+        int length[cellCount][4];
+    };
 
-                    // 保存动作
-                    previousActions[currentTurn][side][tank] = act;
-                    if (tankAlive[side][tank] && ActionIsMove(act))
-                    {
-                        int &x = tankX[side][tank], &y = tankY[side][tank];
-                        FieldItem &items = gameField[y][x];
+    namespace Internals
+    {
+        template<int... I> struct IndexList {};
 
-                        // 记录 Log
-                        DisappearLog log;
-                        log.x = x;
-                        log.y = y;
-                        log.item = tankItemTypes[side][tank];
-                        log.turn = currentTurn;
-                        logs.push(log);
+        template<typename A, typename B> struct ConcatIndexList;
+        template<int... A, int... B> struct ConcatIndexList<IndexList<A...>, IndexList<B...> >
+        {
+            typedef IndexList<A..., (int)sizeof...(A) + B...> Type;
+        };
 
-                        // 变更坐标
-                        x += dx[act];
-                        y += dy[act];
+        // IndexList<0, 1, ..., N - 1>，对半拆分以控制模板递归深度
+        template<int N> struct MakeIndexList
+        {
+            typedef typename ConcatIndexList<typename MakeIndexList<N / 2>::Type,
+                typename MakeIndexList<N - N / 2>::Type>::Type Type;
+        };
+        template<> struct MakeIndexList<0> { typedef IndexList<> Type; };
+        template<> struct MakeIndexList<1> { typedef IndexList<0> Type; };
 
-                        // 更换标记（注意格子可能有多个坦克）
-                        gameField[y][x] |= log.item;
-                        items &= ~log.item;
-                    }
-                }
+        // 生成 BasicRayTable<Height, Width> 的编译期函数
+        // 射线上第 k 步的格子为 cell + k * Delta(dir)，每个字只遍历落在其中的那几步，33x33 的场地也能在常量求值的步数限制内完成
+        template<int Height, int Width>
+        struct RayTableBuilder
+        {
+            typedef BasicRayTable<Height, Width> Table;
+            typedef typename Table::Bitboard Bitboard;
+            typedef typename MakeIndexList<Bitboard::wordCount>::Type WordIndexList;
+            typedef typename MakeIndexList<Table::maxRayLength>::Type StepIndexList;
 
-            // 2 射♂击!
-            set<DisappearLog> itemsToBeDestroyed;
-            for (int side = 0; side < sideCount; side++)
-                for (int tank = 0; tank < tankPerSide; tank++)
-                {
-                    Action act = nextAction[side][tank];
-                    if (tankAlive[side][tank] && ActionIsShoot(act))
-                    {
-                        int dir = ExtractDirectionFromAction(act);
-                        int x = tankX[side][tank], y = tankY[side][tank];
-                        bool hasMultipleTankWithMe = HasMultipleTank(gameField[y][x]);
-                        while (true)
-                        {
-                            x += dx[dir];
-                            y += dy[dir];
-                            if (!CoordValid(x, y))
-                                break;
-                            FieldItem items = gameField[y][x];
-                            //tank will not be on water, and water will not be shot, so it can be handled as None
-                            if (items != None && items != Water)
-                            {
-                                // 对射判断
-                                if (items >= Blue0 &&
-                                    !hasMultipleTankWithMe && !HasMultipleTank(items))
-                                {
-                                    // 自己这里和射到的目标格子都只有一个坦克
-                                    Action theirAction = nextAction[GetTankSide(items)][GetTankID(items)];
-                                    if (ActionIsShoot(theirAction) &&
-                                        ActionDirectionIsOpposite(act, theirAction))
-                                    {
-                                        // 而且我方和对方的射击方向是反的
-                                        // 那么就忽视这次射击
-                                        break;
-                                    }
-                                }
-
-                                // 标记这些物件要被摧毁了（防止重复摧毁）
-                                for (int mask = 1; mask <= Red1; mask <<= 1)
-                                    if (items & mask)
-                                    {
-                                        DisappearLog log;
-                                        log.x = x;
-                                        log.y = y;
-                                        log.item = (FieldItem)mask;
-                                        log.turn = currentTurn;
-                                        itemsToBeDestroyed.insert(log);
-                                    }
-                                break;
-                            }
-                        }
-                    }
-                }
+            static constexpr int Delta(int dir)
+            {
+                return dy[dir] * Width + dx[dir];
+            }
 
-            for (auto& log : itemsToBeDestroyed)
+            // 射线上的格子数
+            static constexpr int RayLength(int cell, int dir)
             {
-                switch (log.item)
-                {
-                case Base:
-                {
-                    int side = log.x == baseX[Blue] && log.y == baseY[Blue] ? Blue : Red;
-                    baseAlive[side] = false;
-                    break;
-                }
-                case Blue0:
-                    _destroyTank(Blue, 0);
-                    break;
-                case Blue1:
-                    _destroyTank(Blue, 1);
-                    break;
-                case Red0:
-                    _destroyTank(Red, 0);
-                    break;
-                case Red1:
-                    _destroyTank(Red, 1);
-                    break;
-                case Steel:
-                    continue;
-                default:
-                    ;
-                }
-                gameField[log.y][log.x] &= ~log.item;
-                logs.push(log);
+                return dir == Up ? cell / Width :
+                    dir == Right ? Width - 1 - cell % Width :
+                    dir == Down ? Height - 1 - cell / Width : cell % Width;
             }
 
-            for (int side = 0; side < sideCount; side++)
-                for (int tank = 0; tank < tankPerSide; tank++)
-                    nextAction[side][tank] = Invalid;
+            // 从 cell 沿 dir 走 k 步到达的格子，出界为 -1
+            static constexpr int RayCell(int cell, int dir, int k)
+            {
+                return k >= 1 && k <= RayLength(cell, dir) ? cell + k * Delta(dir) : -1;
+            }
 
-            currentTurn++;
-            return true;
-        }
+            static constexpr int FloorDiv(int a, int b)
+            {
+                return a >= 0 ? a / b : -((b - 1 - a) / b);
+            }
 
-        // 回到上一回合
-        bool Revert()
-        {
-            if (currentTurn == 1)
-                return false;
+            static constexpr int Max(int a, int b) { return a > b ? a : b; }
+            static constexpr int Min(int a, int b) { return a < b ? a : b; }
 
-            currentTurn--;
-            while (!logs.empty())
+            // cell + k * delta 落在第 w 个字内的第一步 / 最后一步
+            static constexpr int FirstStepInWord(int cell, int delta, int w)
             {
-                DisappearLog& log = logs.top();
-                if (log.turn == currentTurn)
-                {
-                    logs.pop();
-                    switch (log.item)
-                    {
-                    case Base:
-                    {
-                        int side = log.x == baseX[Blue] && log.y == baseY[Blue] ? Blue : Red;
-                        baseAlive[side] = true;
-                        gameField[log.y][log.x] = Base;
-                        break;
-                    }
-                    case Brick:
-                        gameField[log.y][log.x] = Brick;
-                        break;
-                    case Blue0:
-                        _revertTank(Blue, 0, log);
-                        break;
-                    case Blue1:
-                        _revertTank(Blue, 1, log);
-                        break;
-                    case Red0:
-                        _revertTank(Red, 0, log);
-                        break;
-                    case Red1:
-                        _revertTank(Red, 1, log);
-                        break;
-                    default:
-                        ;
-                    }
-                }
-                else
-                    break;
+                return delta > 0 ? -FloorDiv(cell - 64 * w, delta) : -FloorDiv(64 * w + 63 - cell, -delta);
             }
-            return true;
+
+            static constexpr int LastStepInWord(int cell, int delta, int w)
+            {
+                return delta > 0 ? FloorDiv(64 * w + 63 - cell, delta) : FloorDiv(cell - 64 * w, -delta);
+            }
+
+            static constexpr unsigned long long StepBits(int cell, int delta, int w, int k, int last)
+            {
+                return k > last ? 0 : (1ULL << (cell + k * delta - 64 * w)) | StepBits(cell, delta, w, k + 1, last);
+            }
+
+            // 射线在位棋盘第 w 个字上的位
+            static constexpr unsigned long long RayWord(int cell, int dir, int w)
+            {
+                return StepBits(cell, Delta(dir), w, Max(1, FirstStepInWord(cell, Delta(dir), w)),
+                    Min(RayLength(cell, dir), LastStepInWord(cell, Delta(dir), w)));
+            }
+
+            // 格子 target 在位棋盘第 w 个字上的位
+            static constexpr unsigned long long CellWord(int target, int w)
+            {
+                return target >= 0 && target / 64 == w ? 1ULL << (target % 64) : 0;
+            }
+
+            // W 为位棋盘的字
+            template<int... W>
+            static constexpr Bitboard RayMask(int cell, int dir, IndexList<W...>)
+            {
+                return Bitboard{ { RayWord(cell, dir, W)... } };
+            }
+
+            template<int... W>
+            static constexpr Bitboard StepMask(int cell, int dir, IndexList<W...>)
+            {
+                return Bitboard{ { CellWord(RayCell(cell, dir, 1), W)... } };
+            }
+
+            // K 为射线上的步数
+            template<int... K>
+            static constexpr typename Table::CellList RayCells(int cell, int dir, IndexList<K...>)
+            {
+                return typename Table::CellList{ { (typename Table::CellType)RayCell(cell, dir, K + 1)... } };
+            }
+
+            // I 为 cell * 4 + dir
+            template<int... I>
+            static constexpr Table Make(IndexList<I...>)
+            {
+                return Table{
+                    { RayMask(I / 4, I % 4, WordIndexList())... },
+                    { StepMask(I / 4, I % 4, WordIndexList())... },
+                    { RayCell(I / 4, I % 4, 1)... },
+                    { RayCells(I / 4, I % 4, StepIndexList())... },
+                    { RayLength(I / 4, I % 4)... }
+                };
+            }
+        };
+
+        // 同样大小的场地共用一张射线表
+        template<int Height, int Width>
+        struct RayTableInstance
+        {
+            static constexpr BasicRayTable<Height, Width> table =
+                RayTableBuilder<Height, Width>::Make(typename MakeIndexList<Height * Width * 4>::Type());
+        };
+
+        template<int Height, int Width>
+        constexpr BasicRayTable<Height, Width> RayTableInstance<Height, Width>::table;
+    }
+
+    // 场地大小（Height 行 Width 列）、方数和每方的坦克数，以及只与它们有关的常量、格子编号和射线表
+    // 其余的类都以这四个数为模板参数，循环次数均为编译期常量
+    template<int Height, int Width, int Sides, int Tanks>
+    struct FieldSize
+    {
+        static const int fieldHeight = Height, fieldWidth = Width, sideCount = Sides, tankPerSide = Tanks;
+
+        static const int tankCount = Sides * Tanks;
+
+        // 格子编号：y * fieldWidth + x
+        static const int cellCount = Height * Width;
+
+        // 物件在位棋盘数组中的下标（即 FieldItem 的二进制位序号，Brick 为 0，Water 为 7）
+        static const int itemTypeCount = tankCount > 4 ? tankCount + 4 : 8;
+
+        // 每回合最多产生的 DisappearLog 数：每个坦克移动一次，每发子弹至多摧毁一个非坦克物件，加上所有坦克
+        static const int maxLogPerTurn = tankCount * 3;
+
+        // 坦克离基地最远的距离
+        static const int maxTankOffset = (Tanks + 1) / 2 * 2;
+
+        static_assert(Sides >= 2 && Sides <= 4, "bases sit at the midpoints of the four edges");
+        static_assert(itemTypeCount <= 31, "FieldItem is an int bit set");
+        static_assert(maxTankOffset <= (Width - 1) / 2 &&
+            (Sides <= 2 || (maxTankOffset < (Width - 1) / 2 && maxTankOffset < (Height - 1) / 2)),
+            "starting tanks must fit on their edge without sharing corners");
+
+        typedef BasicBitboard<cellCount> Bitboard;
+        typedef BasicRayTable<Height, Width> RayTable;
+
+        static const int bitboardWords = Bitboard::wordCount;
+
+        // 坦克所在格子编号的类型，-1 表示已炸
+        typedef typename RayTable::CellType CellType;
+
+        // 每个坦克（或每方）一位的掩码
+        typedef typename std::conditional<(tankCount <= 8), unsigned char,
+            typename std::conditional<(tankCount <= 16), unsigned short, unsigned int>::type>::type TankMask;
+
+        static constexpr const RayTable& rayTable = Internals::RayTableInstance<Height, Width>::table;
+
+        static constexpr bool CoordValid(int x, int y)
+        {
+            return x >= 0 && x < Width && y >= 0 && y < Height;
+        }
+
+        static constexpr int CellIndex(int x, int y)
+        {
+            return y * Width + x;
+        }
+
+        static constexpr int CellX(int cell)
+        {
+            return cell % Width;
+        }
+
+        static constexpr int CellY(int cell)
+        {
+            return cell / Width;
+        }
+
+        // 基地：蓝方在上边中点，红方在下边中点，第 3、4 方在左、右边中点
+        static constexpr int BaseX(int side)
+        {
+            return side < 2 ? Width / 2 : side == 2 ? 0 : Width - 1;
+        }
+
+        static constexpr int BaseY(int side)
+        {
+            return side == 0 ? 0 : side == 1 ? Height - 1 : Height / 2;
+        }
+
+        // 坦克与基地在同一条边上，依次在基地两侧相距 2、4…… 格处，相对的两方关于场地中心对称
+        static constexpr int TankOffset(int side, int tank)
+        {
+            return (tank / 2 + 1) * 2 * ((tank % 2 == 0) == (side % 2 == 0) ? -1 : 1);
+        }
+
+        static constexpr int TankStartX(int side, int tank)
+        {
+            return side < 2 ? BaseX(side) + TankOffset(side, tank) : BaseX(side);
+        }
+
+        static constexpr int TankStartY(int side, int tank)
+        {
+            return side < 2 ? BaseY(side) : BaseY(side) + TankOffset(side, tank);
+        }
+
+        // 坦克对应的物件的位序号：前 4 个坦克为 Blue0 到 Red1，之后跳过 Water
+        static constexpr int TankItemIndex(int side, int tank)
+        {
+            return side * Tanks + tank < 4 ? 3 + side * Tanks + tank : 4 + side * Tanks + tank;
+        }
+
+        static constexpr FieldItem TankItem(int side, int tank)
+        {
+            return (FieldItem)(1 << TankItemIndex(side, tank));
+        }
+
+        // item 须为单个坦克
+        static int GetTankSide(FieldItem item)
+        {
+            return _tankIndex(item) / Tanks;
+        }
+
+        static int GetTankID(FieldItem item)
+        {
+            return _tankIndex(item) % Tanks;
+        }
+
+        // 两方对战时规则在以下变换下不变：第 0 位为左右镜像，第 1 位为上下翻转并交换双方，共 symmetryCount 种
+        // 左右镜像要求基地在中间一列（宽为奇数）
+        static const int symmetryCount = 4;
+
+        static constexpr int SymmetricCell(int cell, int symmetry)
+        {
+            return CellIndex(symmetry & 1 ? Width - 1 - CellX(cell) : CellX(cell),
+                symmetry & 2 ? Height - 1 - CellY(cell) : CellY(cell));
+        }
+
+        static constexpr int SymmetricSide(int side, int symmetry)
+        {
+            return symmetry & 2 ? 1 - side : side;
+        }
+
+        // 移动和射击的方向随之变换，Stay 和 Invalid 不变
+        static Action SymmetricAction(Action act, int symmetry)
+        {
+            if (act < Up)
+                return act;
+            int dir = ExtractDirectionFromAction(act);
+            if (symmetry & (dir & 1 ? 1 : 2)) // 左右方向是奇数
+                return (Action)(act ^ 2);
+            return act;
+        }
+
+        // 沿射线的第一个障碍格，没有则返回 -1
+        // obstacles 为挡住射线的格子（如 TankField::obstacles），只需两次位运算和一次位扫描
+        static int FirstObstacle(int cell, int dir, const Bitboard& obstacles)
+        {
+            Bitboard hits = rayTable.ray[cell][dir] & obstacles;
+            return rayAscending[dir] ? hits.Lowest() : hits.Highest();
+        }
+
+        // 在位棋盘上结算所有存活坦克的射击，返回被击中的格子
+        // tankCell 为移动后坦克所在的格子（-1 表示已炸），obstacles 为挡子弹的物件（水以外的所有物件）
+        template<typename CellT>
+        static Bitboard ResolveShots(const CellT (&tankCell)[Sides][Tanks],
+            const Action (&act)[Sides][Tanks], const Bitboard& obstacles)
+        {
+            Bitboard hit = {};
+            for (int side = 0; side < Sides; side++)
+                for (int tank = 0; tank < Tanks; tank++)
+                {
+                    int cell = tankCell[side][tank];
+                    if (cell < 0 || !ActionIsShoot(act[side][tank]))
+                        continue;
+                    int target = FirstObstacle(cell, ExtractDirectionFromAction(act[side][tank]), obstacles);
+                    if (target < 0)
+                        continue;
+
+                    // 对射判断：自己这里和射到的目标格子都只有一个坦克，而且射击方向相反，那么就忽视这次射击
+                    int myCount = 0, targetCount = 0, targetSide = 0, targetTank = 0;
+                    for (int s = 0; s < Sides; s++)
+                        for (int t = 0; t < Tanks; t++)
+                        {
+                            myCount += tankCell[s][t] == cell;
+                            if (tankCell[s][t] == target)
+                            {
+                                targetCount++;
+                                targetSide = s;
+                                targetTank = t;
+                            }
+                        }
+                    if (myCount == 1 && targetCount == 1)
+                    {
+                        Action theirAction = act[targetSide][targetTank];
+                        if (ActionIsShoot(theirAction) && ActionDirectionIsOpposite(act[side][tank], theirAction))
+                            continue;
+                    }
+                    hit.Set(target);
+                }
+            return hit;
+        }
+
+        // 由已失败的各方（第 side 位，坦克全炸或基地被炸）得出的结果，timeUp 表示已到回合上限
+        static GameResult JudgeResult(unsigned failedSides, bool timeUp)
+        {
+            unsigned alive = ~failedSides & ((1u << Sides) - 1);
+            if (alive && !(alive & (alive - 1)))
+                return (GameResult)LowestBitIndex(alive);
+            return !alive || timeUp ? Draw : NotFinished;
+        }
+
+        // 游戏结束的原因（GameEndReason 的组合），baseLost、tanksLost 分别为基地被炸、坦克全炸的各方
+        static GameEndReason JudgeEndReason(unsigned baseLost, unsigned tanksLost, bool timeUp)
+        {
+            unsigned alive = ~(baseLost | tanksLost) & ((1u << Sides) - 1);
+            if (JudgeResult(baseLost | tanksLost, timeUp) == NotFinished)
+                return NotEnded;
+            GameEndReason reason = NotEnded;
+            if (baseLost)
+                reason |= BaseDestroyed;
+            if (tanksLost)
+                reason |= TanksDestroyed;
+            if (alive & (alive - 1))
+                reason |= TurnLimit;
+            return reason;
+        }
+
+    private:
+        static int _tankIndex(FieldItem item)
+        {
+            int bit = LowestBitIndex((unsigned)item);
+            return bit < 7 ? bit - 3 : bit - 4;
+        }
+    };
+
+    template<int Height, int Width, int Sides, int Tanks>
+    constexpr const typename FieldSize<Height, Width, Sides, Tanks>::RayTable& FieldSize<Height, Width, Sides, Tanks>::rayTable;
+
+    // 所有坦克在同一回合的动作
+    template<int Sides, int Tanks>
+    struct BasicJointAction
+    {
+        Action act[Sides][Tanks];
+    };
+
+    // 按回合记录的动作，每个动作占 4 位（存 act - Invalid）
+    // 只保留最近 Turns 个回合，第 turn 回合存在 turn % Turns 处，更早的回合会被覆盖
+    template<int Sides, int Tanks, int Turns>
+    struct BasicActionHistory
+    {
+        static const int bytesPerTurn = (Sides * Tanks + 1) / 2;
+
+        unsigned char packed[Turns][bytesPerTurn] = {};
+
+        Action Get(int turn, int side, int tank) const
+        {
+            int i = side * Tanks + tank;
+            return (Action)((packed[turn % Turns][i / 2] >> (i % 2 * 4) & 15) + Invalid);
+        }
+
+        void Set(int turn, int side, int tank, Action act)
+        {
+            int i = side * Tanks + tank, shift = i % 2 * 4;
+            unsigned char& b = packed[turn % Turns][i / 2];
+            b = (unsigned char)((b & ~(15 << shift)) | (act - Invalid) << shift);
+        }
+    };
+
+    // 动作掩码：第 act - Stay 位表示动作 act（共 9 种，不含 Invalid）
+    inline unsigned short ActionBit(Action act)
+    {
+        return (unsigned short)(1 << (act - Stay));
+    }
+
+    const unsigned short allActionsMask = (1 << (LeftShoot - Stay + 1)) - 1;
+
+    // 生成合法动作时的剪枝选项，可以组合
+    enum ActionPruning
+    {
+        PruneNone = 0,
+
+        // 已炸的坦克只取 Stay（DoAction 不关心它们的动作）
+        PruneDeadTanks = 1,
+
+        // 本回合不可能打到任何东西的射击方向只保留一个，它们的结果完全相同
+        PruneUselessShots = 2,
+
+        // 局面左右对称时（同一方的坦克可以交换编号），互为镜像的两个联合动作得到互为镜像的局面，只枚举其中一个
+        // 上下翻转要交换双方，镜像局面的价值对双方相反，不能剪；由 GetLegalActionMasks 填写 ActionSymmetry 交给迭代器
+        PruneSymmetric = 4
+    };
+
+    // 联合动作的左右镜像（见 PruneSymmetric）：坦克按 side * Tanks + tank 编号，
+    // 第 i 个坦克的动作 act 镜像为第 partner[i] 个坦克的动作 image[i][act - Stay]；active 为 false 时局面不对称
+    template<int Sides, int Tanks>
+    struct BasicActionSymmetry
+    {
+        static const int tankCount = Sides * Tanks;
+
+        bool active;
+        int partner[tankCount];
+        Action image[tankCount][LeftShoot - Stay + 1];
+    };
+
+    // 枚举各坦克合法动作的笛卡尔积
+    // 给出 symmetry 时，互为镜像的两个联合动作只取按坦克顺序比较较小的一个
+    template<int Sides, int Tanks>
+    class BasicJointActionIterator
+    {
+    public:
+        static const int tankCount = Sides * Tanks;
+
+        typedef BasicJointAction<Sides, Tanks> JointAction;
+        typedef BasicActionSymmetry<Sides, Tanks> ActionSymmetry;
+
+        explicit BasicJointActionIterator(const unsigned short (&masks)[Sides][Tanks], const ActionSymmetry* symmetry = nullptr)
+        {
+            mirrored = symmetry && symmetry->active;
+            if (mirrored)
+                this->symmetry = *symmetry;
+            for (int i = 0; i < tankCount; i++)
+            {
+                count[i] = 0;
+                for (int act = Stay; act <= LeftShoot; act++)
+                    if (masks[i / Tanks][i % Tanks] & ActionBit((Action)act))
+                        choices[i][count[i]++] = (Action)act;
+            }
+            Reset();
+        }
+
+        // 回到第一个联合动作
+        void Reset()
+        {
+            memset(index, 0, sizeof(index));
+            done = Count() == 0;
+        }
+
+        // 联合动作的总数（对称剪枝之前）
+        long long Count() const
+        {
+            long long total = 1;
+            for (int i = 0; i < tankCount; i++)
+                total *= count[i];
+            return total;
+        }
+
+        // 取出下一个联合动作，已经枚举完则返回 false
+        bool Next(JointAction& joint)
+        {
+            while (!done)
+            {
+                for (int i = 0; i < tankCount; i++)
+                    joint.act[i / Tanks][i % Tanks] = choices[i][index[i]];
+
+                // 按混合进制加一
+                int i = 0;
+                while (i < tankCount && ++index[i] == count[i])
+                    index[i++] = 0;
+                done = i == tankCount;
+
+                if (!mirrored || !_mirrorIsSmaller(joint))
+                    return true;
+            }
+            return false;
+        }
+
+    private:
+        Action choices[tankCount][LeftShoot - Stay + 1];
+        int count[tankCount];
+        int index[tankCount];
+        bool done;
+        bool mirrored;
+        ActionSymmetry symmetry;
+
+        bool _mirrorIsSmaller(const JointAction& joint) const
+        {
+            Action image[tankCount];
+            for (int i = 0; i < tankCount; i++)
+                image[symmetry.partner[i]] = symmetry.image[i][joint.act[i / Tanks][i % Tanks] - Stay];
+            for (int i = 0; i < tankCount; i++)
+                if (image[i] != joint.act[i / Tanks][i % Tanks])
+                    return image[i] < joint.act[i / Tanks][i % Tanks];
+            return false;
+        }
+    };
+
+    // Zobrist 随机键：局面哈希为所有键的异或
+    // 坦克的存活由其所在格子的键体现，基地同理
+    template<typename Size>
+    struct BasicZobristTable
+    {
+        // item[格子][物件下标]
+        unsigned long long item[Size::cellCount][Size::itemTypeCount];
+
+        // 上回合射击过的坦克
+        unsigned long long shot[Size::sideCount][Size::tankPerSide];
+
+        // 不区分编号的坦克：tank[格子][方][上回合是否射击]，用于对称规范化的键（见 TankState::CanonicalKey）
+        unsigned long long tank[Size::cellCount][Size::sideCount][2];
+
+        // 每种规模一张
+        static const BasicZobristTable table;
+
+        BasicZobristTable()
+        {
+            // splitmix64，固定种子，保证每次运行的哈希一致
+            unsigned long long seed = 0x9E3779B97F4A7C15ULL;
+            for (int cell = 0; cell < Size::cellCount; cell++)
+                for (int i = 0; i < Size::itemTypeCount; i++)
+                    item[cell][i] = _next(seed);
+            for (int side = 0; side < Size::sideCount; side++)
+                for (int tank = 0; tank < Size::tankPerSide; tank++)
+                    shot[side][tank] = _next(seed);
+            for (int cell = 0; cell < Size::cellCount; cell++)
+                for (int side = 0; side < Size::sideCount; side++)
+                    for (int shot = 0; shot < 2; shot++)
+                        tank[cell][side][shot] = _next(seed);
+        }
+
+        // 格子上所有物件的键
+        unsigned long long Cell(int x, int y, FieldItem items) const
+        {
+            unsigned long long key = 0;
+            for (int i = 0; i < Size::itemTypeCount; i++)
+                if (items & (1 << i))
+                    key ^= item[Size::CellIndex(x, y)][i];
+            return key;
+        }
+
+    private:
+        static unsigned long long _next(unsigned long long& seed)
+        {
+            unsigned long long z = (seed += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+    };
+
+    template<typename Size>
+    const BasicZobristTable<Size> BasicZobristTable<Size>::table;
+
+    // TankField::Preview 的结果：执行一个联合动作会带来的变化
+    template<typename Size>
+    struct BasicTurnPreview
+    {
+        typedef typename Size::Bitboard Bitboard;
+
+        // 联合动作是否合法，不合法时其余成员没有意义
+        bool valid;
+
+        // 执行之后坦克所在的格子，已炸（包括这回合被炸）的坦克为 -1
+        int tankCell[Size::sideCount][Size::tankPerSide];
+
+        // 被击中的格子，和其中被摧毁的砖块
+        Bitboard hit, destroyedBricks;
+
+        // 这回合被摧毁的坦克（第 side * tankPerSide + tank 位）和基地（第 side 位）
+        unsigned destroyedTanks, destroyedBases;
+
+        // 执行之后的结果
+        GameResult result;
+        GameEndReason endReason;
+    };
+
+    // 攻击图：每个坦克如果下回合射击，子弹在各个方向上经过的格子（到第一个障碍为止，含这个障碍）
+    // 按当前局面计算，不考虑下回合的移动；已炸的和上回合射击过（不能连续射击）的坦克没有射线
+    template<typename Size>
+    struct BasicAttackMap
+    {
+        typedef typename Size::Bitboard Bitboard;
+
+        static const int sideCount = Size::sideCount, tankPerSide = Size::tankPerSide;
+
+        // ray[side][tank][dir]
+        Bitboard ray[sideCount][tankPerSide][4];
+
+        // 射线的终点，即会被击中的格子；没有射线或射线上没有障碍时为 -1
+        int target[sideCount][tankPerSide][4];
+
+        // 每一方所有射线的并，其他方的坦克在这些格子上时下回合可能被击中
+        Bitboard threat[sideCount];
+
+        // canShoot 的第 side * tankPerSide + tank 位表示该坦克下回合可以射击
+        // obstacles 为挡子弹的格子（水以外的所有物件）
+        template<typename CellT>
+        void Compute(const CellT (&tankCell)[sideCount][tankPerSide], unsigned canShoot, const Bitboard& obstacles)
+        {
+            for (int side = 0; side < sideCount; side++)
+            {
+                threat[side] = Bitboard();
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    int cell = tankCell[side][tank];
+                    bool armed = cell >= 0 && (canShoot >> (side * tankPerSide + tank) & 1);
+                    for (int dir = 0; dir < 4; dir++)
+                    {
+                        Bitboard& r = ray[side][tank][dir];
+                        int& t = target[side][tank][dir];
+                        if (!armed)
+                        {
+                            r = Bitboard();
+                            t = -1;
+                            continue;
+                        }
+                        t = Size::FirstObstacle(cell, dir, obstacles);
+                        r = t < 0 ? Size::rayTable.ray[cell][dir] : Size::rayTable.ray[cell][dir] - Size::rayTable.ray[t][dir];
+                        threat[side] |= r;
+                    }
+                }
+            }
+        }
+
+        // side 方以外、下回合射击能打中 cell 的第一个坦克（编号为 side * tankPerSide + tank），没有或 cell < 0 时返回 -1
+        int ThreatTo(int cell, int side) const
+        {
+            if (cell < 0)
+                return -1;
+            for (int s = 0; s < sideCount; s++)
+                if (s != side && threat[s].Test(cell))
+                    for (int tank = 0; tank < tankPerSide; tank++)
+                        for (int dir = 0; dir < 4; dir++)
+                            if (target[s][tank][dir] == cell)
+                                return s * tankPerSide + tank;
+            return -1;
+        }
+    };
+
+    // 威胁图：对方坦克的火力线，每回合按局面算一次，供所有寻路共用（见 FlowField、ActionPlanner::Plan 的 penalty）
+    // now 为它们下回合射击能打到的格子（即 AttackMap::threat），next 为它们先走一步或不动、再下一回合射击能打到的格子
+    // penalty[cell] 为进入 cell 的额外代价：在 now 里加 nowPenalty，只在 next 里加 nextPenalty；
+    // 寻路只查表，不在每条边上重新看射线
+    template<typename Size>
+    struct BasicThreatMap
+    {
+        typedef typename Size::Bitboard Bitboard;
+        typedef BasicAttackMap<Size> AttackMap;
+
+        static const int cellCount = Size::cellCount, sideCount = Size::sideCount, tankPerSide = Size::tankPerSide;
+
+        static const int nowPenalty = 4, nextPenalty = 2;
+
+        Bitboard now, next;
+
+        unsigned char penalty[cellCount];
+
+        // side 为我方，attacks 为当前局面的攻击图；tankCell、obstacles 同 AttackMap::Compute，blocked 为钢墙和水
+        template<typename CellT>
+        void Compute(const AttackMap& attacks, const CellT (&tankCell)[sideCount][tankPerSide], int side,
+            const Bitboard& obstacles, const Bitboard& blocked)
+        {
+            now = next = Bitboard();
+            for (int s = 0; s < sideCount; s++)
+            {
+                if (s == side)
+                    continue;
+                now |= attacks.threat[s];
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    int cell = tankCell[s][tank];
+                    if (cell < 0)
+                        continue;
+                    // 下下回合总能射击，不管下回合射不射
+                    _addRays(cell, obstacles);
+
+                    // 走开之后原来的格子就空了，除非还有别的坦克在那里
+                    Bitboard moved = obstacles;
+                    if (!_shared(tankCell, s, tank))
+                        moved.Reset(cell);
+                    for (int dir = 0; dir < 4; dir++)
+                    {
+                        int to = Size::rayTable.neighbor[cell][dir];
+                        if (to >= 0 && !obstacles.Test(to) && !blocked.Test(to))
+                            _addRays(to, moved);
+                    }
+                }
+            }
+            next -= now;
+            for (int cell = 0; cell < cellCount; cell++)
+                penalty[cell] = now.Test(cell) ? nowPenalty : next.Test(cell) ? nextPenalty : 0;
+        }
+
+    private:
+        template<typename CellT>
+        static bool _shared(const CellT (&tankCell)[sideCount][tankPerSide], int side, int tank)
+        {
+            for (int s = 0; s < sideCount; s++)
+                for (int t = 0; t < tankPerSide; t++)
+                    if ((s != side || t != tank) && tankCell[s][t] == tankCell[side][tank])
+                        return true;
+            return false;
+        }
+
+        void _addRays(int cell, const Bitboard& obstacles)
+        {
+            for (int dir = 0; dir < 4; dir++)
+            {
+                int t = Size::FirstObstacle(cell, dir, obstacles);
+                next |= t < 0 ? Size::rayTable.ray[cell][dir] : Size::rayTable.ray[cell][dir] - Size::rayTable.ray[t][dir];
+            }
+        }
+    };
+
+    // 全源最短路表：distance[from][to] 为坦克从 from 走到 to 至少需要的回合数
+    // 进入空地（有坦克也算空地）计 1 回合，进入砖块计 2 回合（先射击，再移动）；钢墙和水不能进入
+    // 基地只能作为终点（计 2 回合，即射击它），不能途经
+    // 表只随砖块变化：开局时 Build 一次，之后每回合 Sync，被摧毁的砖块逐个增量更新，不重建
+    template<typename Size>
+    struct BasicDistanceTable
+    {
+        typedef typename Size::Bitboard Bitboard;
+
+        static const int cellCount = Size::cellCount;
+
+        // 到不了
+        static const unsigned short unreachable = 0xFFFF;
+
+        unsigned short distance[cellCount][cellCount];
+
+        // 表对应的砖块，和不能进入的格子（钢墙、水）
+        Bitboard brick, blocked;
+
+        // 所有基地所在的格子
+        Bitboard bases;
+
+        // 进入各格子的回合数，不能进入时为 0；由上面三者决定，与它们同步维护
+        unsigned char cost[cellCount];
+
+        // 进入 cell 的回合数，不能进入时为 0
+        int Cost(int cell) const
+        {
+            return cost[cell];
+        }
+
+        // 从头建表，每个起点一次 Dijkstra
+        void Build(const Bitboard& brick, const Bitboard& blocked)
+        {
+            this->brick = brick;
+            this->blocked = blocked;
+            bases = Bitboard();
+            for (int side = 0; side < Size::sideCount; side++)
+                bases.Set(Size::CellIndex(Size::BaseX(side), Size::BaseY(side)));
+            for (int cell = 0; cell < cellCount; cell++)
+                cost[cell] = blocked.Test(cell) ? 0 : brick.Test(cell) || bases.Test(cell) ? 2 : 1;
+            for (int from = 0; from < cellCount; from++)
+                _search(from);
+        }
+
+        // cell 上的砖块被摧毁，进入它的代价由 2 变为 1
+        // 新的最短路要么不经过 cell（长度不变），要么恰好经过它一次，所以对每个起点 from：
+        //   distance[from][cell] 减 1，distance[from][to] 与 distance[from][cell] + distance[cell][to] 取小
+        // distance[cell][·] 的最短路不会回到 cell，不受影响；整体为 O(cellCount^2)
+        void RemoveBrick(int cell)
+        {
+            brick.Reset(cell);
+            cost[cell] = 1;
+            const unsigned short* via = distance[cell];
+            for (int from = 0; from < cellCount; from++)
+            {
+                unsigned short* d = distance[from];
+                if (from == cell || d[cell] == unreachable)
+                    continue;
+                int toCell = --d[cell];
+                for (int to = 0; to < cellCount; to++)
+                    if (via[to] != unreachable && toCell + via[to] < d[to])
+                        d[to] = (unsigned short)(toCell + via[to]);
+            }
+        }
+
+        // 跟上场地当前的砖块：少了的砖块逐个 RemoveBrick；多了砖块（如 Revert 之后）则重建
+        void Sync(const Bitboard& current)
+        {
+            if ((current - brick).Any())
+            {
+                Build(current, blocked);
+                return;
+            }
+            for (Bitboard removed = brick - current; removed.Any();)
+                RemoveBrick(removed.PopLowest());
+        }
+
+        // 从 from 去 to 的一条最短路上的下一个格子，已经到达或到不了时返回 -1
+        // 沿着它一格一格地走，取出整条路径的代价与路径长度成正比
+        int NextCell(int from, int to) const
+        {
+            int total = distance[from][to];
+            if (from == to || total == unreachable)
+                return -1;
+            for (int dir = 0; dir < 4; dir++)
+            {
+                int next = Size::rayTable.neighbor[from][dir];
+                if (next < 0 || (next != to && bases.Test(next)))
+                    continue;
+                if (cost[next] && distance[next][to] != unreachable && cost[next] + distance[next][to] == total)
+                    return next;
+            }
+            return -1;
+        }
+
+    private:
+        // 边权只有 1 和 2，用 3 个轮转的桶代替堆（Dial 算法）
+        void _search(int from)
+        {
+            unsigned short* d = distance[from];
+            for (int cell = 0; cell < cellCount; cell++)
+                d[cell] = unreachable;
+            d[from] = 0;
+            if (blocked.Test(from) || bases.Test(from))
+                return;
+
+            // 同一个桶里每个格子至多一项，桶的容量为 cellCount 即可
+            int bucket[3][cellCount], size[3] = { 1, 0, 0 };
+            bucket[0][0] = from;
+            for (int dist = 0, pending = 1; pending; dist++)
+            {
+                int* current = bucket[dist % 3];
+                int& count = size[dist % 3];
+                for (int i = 0; i < count; i++)
+                {
+                    int cell = current[i];
+                    pending--;
+                    // 过时的项；基地不能途经
+                    if (d[cell] != dist || (cell != from && cost[cell] == 2 && bases.Test(cell)))
+                        continue;
+                    for (int dir = 0; dir < 4; dir++)
+                    {
+                        int next = Size::rayTable.neighbor[cell][dir];
+                        int step = next < 0 ? 0 : cost[next];
+                        if (step && dist + step < d[next])
+                        {
+                            d[next] = (unsigned short)(dist + step);
+                            int b = (dist + step) % 3;
+                            bucket[b][size[b]++] = next;
+                            pending++;
+                        }
+                    }
+                }
+                count = 0;
+            }
+        }
+    };
+
+    // 单次的点到点寻路（A*），代价规则同 DistanceTable，另外可以把任意格子（如其他坦克）当作不能进入
+    // 用于表给不出答案的动态局面，和搜索中推演出来的局面
+    // 边权只有 1 和 2，启发为曼哈顿距离（一致的），出队的 f 单调不减且每次入队的 f 至多大 3，
+    // 所以按 f 分成 4 个轮转的桶（Dial 算法）代替堆；每格的状态放在扁平数组里，
+    // 用代数（generation）区分是否属于本次搜索，开始新的搜索不需要清零
+    template<typename Size>
+    struct BasicPathSearch
+    {
+        typedef typename Size::Bitboard Bitboard;
+
+        static const int cellCount = Size::cellCount;
+
+        // 从 from 走到 to 的最少回合数，到不了时返回 -1，找到的路径用 Route 取出
+        // blocked 为不能进入的格子（钢墙、水，以及调用者想绕开的格子）
+        int Search(int from, int to, const Bitboard& brick, const Bitboard& blocked)
+        {
+            if (++generation == 0)
+            {
+                memset(seen, 0, sizeof(seen));
+                memset(closed, 0, sizeof(closed));
+                generation = 1;
+            }
+            target = to;
+            found = false;
+            int size[4] = {};
+            int pending = 0;
+            _push(from, 0, -1, size, pending);
+            for (int f = _estimate(from); pending; f++)
+            {
+                int* current = bucket[f & 3];
+                int& count = size[f & 3];
+
+                // 处理当前桶时可能有 f 相同的格子入队，count 会增长
+                for (int i = 0; i < count; i++)
+                {
+                    int cell = current[i];
+                    pending--;
+                    if (closed[cell] == generation || g[cell] + _estimate(cell) != f)
+                        continue;
+                    if (cell == to)
+                    {
+                        found = true;
+                        return g[cell];
+                    }
+                    closed[cell] = generation;
+                    if (cell != from && _isBase(cell))
+                        continue;
+                    for (int dir = 0; dir < 4; dir++)
+                    {
+                        int next = Size::rayTable.neighbor[cell][dir];
+                        if (next < 0 || blocked.Test(next) || closed[next] == generation || (next != to && _isBase(next)))
+                            continue;
+                        _push(next, g[cell] + (brick.Test(next) || _isBase(next) ? 2 : 1), cell, size, pending);
+                    }
+                }
+                count = 0;
+            }
+            return -1;
+        }
+
+        // 上次 Search 找到的路径（不含起点，含终点）写入 cells，返回格子数；没有找到时返回 0
+        int Route(int* cells) const
+        {
+            if (!found)
+                return 0;
+            int length = 0;
+            for (int cell = target; parent[cell] >= 0; cell = parent[cell])
+                length++;
+            for (int cell = target, i = length; i > 0; cell = parent[cell])
+                cells[--i] = cell;
+            return length;
+        }
+
+    private:
+        // 同一个 f 的桶里每个格子至多一项
+        int bucket[4][cellCount];
+
+        // 以下数组中，seen[cell] == generation 时 g、parent 有效，closed[cell] == generation 时已出队
+        int g[cellCount], parent[cellCount];
+        unsigned seen[cellCount] = {}, closed[cellCount] = {};
+        unsigned generation = 0;
+
+        int target = -1;
+        bool found = false;
+
+        int _estimate(int cell) const
+        {
+            return abs(Size::CellX(cell) - Size::CellX(target)) + abs(Size::CellY(cell) - Size::CellY(target));
+        }
+
+        static bool _isBase(int cell)
+        {
+            for (int side = 0; side < Size::sideCount; side++)
+                if (cell == Size::CellIndex(Size::BaseX(side), Size::BaseY(side)))
+                    return true;
+            return false;
+        }
+
+        void _push(int cell, int cost, int from, int (&size)[4], int& pending)
+        {
+            if (seen[cell] == generation && g[cell] <= cost)
+                return;
+            seen[cell] = generation;
+            g[cell] = cost;
+            parent[cell] = from;
+            int b = (cost + _estimate(cell)) & 3;
+            bucket[b][size[b]++] = cell;
+            pending++;
+        }
+    };
+
+    // 到一个目标格子的距离场：distance[cell] 为从 cell 走到目标的最少代价，从目标出发反向做一次 Dijkstra 得到
+    // 所有坦克（以及搜索）共用同一个场，每一步只需在相邻格子里取代价最小的一个，不必各自寻路
+    // 进入各格子的代价由调用者给出（0 为不能进入），通常是 DistanceTable::cost 加上每回合变化的代价
+    // 代价变化（砖块被摧毁、坦克移动）后用 Update 增量修复（LPA*），只重新计算最短路受影响的格子
+    template<typename Size>
+    struct BasicFlowField
+    {
+        static const int cellCount = Size::cellCount;
+
+        // 进入一个格子的代价的上限
+        static const int maxCost = 15;
+
+        // 到不了
+        static const unsigned short unreachable = 0xFFFF;
+
+        // 目标格子，Compute 之前为 -1
+        int goal = -1;
+
+        unsigned short distance[cellCount];
+
+        // 计算时使用的代价，目标以外的基地被置为 0（不能途经）
+        unsigned char cost[cellCount];
+
+        BasicFlowField()
+        {
+            for (int key = 0; key <= keyLimit; key++)
+                head[key] = -1;
+        }
+
+        // 从头计算
+        void Compute(int goal, const unsigned char (&cost)[cellCount])
+        {
+            this->goal = goal;
+            for (int cell = 0; cell < cellCount; cell++)
+                this->cost[cell] = _otherBase(cell) ? 0 : cost[cell];
+            _dial();
+            memcpy(rhs, distance, sizeof(rhs));
+        }
+
+        // 代价变为 cost 后修复距离场，结果与 Compute 相同，返回重新计算过的格子数
+        // 只有变了代价的格子和依赖它们的格子会进入队列，变化少时远快于 Compute
+        int Update(const unsigned char (&cost)[cellCount])
+        {
+            entryCount = 0;
+            lowKey = keyLimit + 1;
+            highKey = -1;
+            overflow = false;
+            for (int cell = 0; cell < cellCount; cell++)
+            {
+                if (cost[cell] == this->cost[cell])
+                    continue;
+                int before = this->cost[cell], after = _otherBase(cell) ? 0 : cost[cell];
+                if (after == before)
+                    continue;
+                this->cost[cell] = (unsigned char)after;
+                // cell 能否途经影响它自己的 rhs
+                if (!before != !after)
+                    _updateCell(cell);
+                // 进入 cell 的代价影响相邻格子的 rhs：变小时直接取小，变大时只有经过 cell 的才需要重算
+                if (distance[cell] == unreachable)
+                    continue;
+                bool cheaper = after && (!before || after < before);
+                for (int dir = 0; dir < 4; dir++)
+                {
+                    int prev = Size::rayTable.neighbor[cell][dir];
+                    if (prev < 0)
+                        continue;
+                    if (cheaper)
+                        _offer(prev, after + distance[cell]);
+                    else if (before && rhs[prev] == before + distance[cell])
+                        _updateCell(prev);
+                }
+            }
+            // LPA* 出队的键单调不减，从最小的键往上扫桶即可
+            int expanded = 0;
+            for (int key = lowKey; key <= highKey && !overflow; key++)
+            while (head[key] >= 0 && !overflow)
+            {
+                int entry = head[key], cell = entryCell[entry];
+                head[key] = entryNext[entry];
+                // 同一个格子可能入队多次，只处理与当前状态相符的一项
+                if (distance[cell] == rhs[cell] || key != std::min(distance[cell], rhs[cell]))
+                    continue;
+                expanded++;
+                int old = distance[cell];
+                if (old > rhs[cell])
+                {
+                    distance[cell] = rhs[cell];
+                    if (cost[cell])
+                        for (int dir = 0; dir < 4; dir++)
+                            if (Size::rayTable.neighbor[cell][dir] >= 0)
+                                _offer(Size::rayTable.neighbor[cell][dir], cost[cell] + distance[cell]);
+                }
+                else
+                {
+                    distance[cell] = unreachable;
+                    _updateCell(cell);
+                    if (cost[cell])
+                        for (int dir = 0; dir < 4; dir++)
+                        {
+                            int prev = Size::rayTable.neighbor[cell][dir];
+                            if (prev >= 0 && rhs[prev] == cost[cell] + old)
+                                _updateCell(prev);
+                        }
+                }
+            }
+
+            // 变化太多、队列放不下时退回从头计算
+            if (overflow)
+            {
+                for (int key = lowKey; key <= highKey; key++)
+                    head[key] = -1;
+                _dial();
+                memcpy(rhs, distance, sizeof(rhs));
+                return cellCount;
+            }
+            return expanded;
+        }
+
+        // 从 from 出发的下一个格子，已到达或到不了时返回 -1
+        int NextCell(int from) const
+        {
+            if (from == goal || distance[from] == unreachable)
+                return -1;
+            int best = -1, bestDistance = unreachable;
+            for (int dir = 0; dir < 4; dir++)
+            {
+                int next = Size::rayTable.neighbor[from][dir];
+                if (next < 0 || !cost[next] || distance[next] == unreachable)
+                    continue;
+                if (cost[next] + distance[next] < bestDistance)
+                {
+                    best = next;
+                    bestDistance = cost[next] + distance[next];
+                }
+            }
+            return best;
+        }
+
+    private:
+        // 一步前瞻的距离：rhs[cell] = min(cost[next] + distance[next])，目标为 0
+        // 所有格子的 rhs 都等于 distance 时距离场是精确的
+        unsigned short rhs[cellCount];
+
+        // Update 的优先队列：按键 min(distance, rhs) 分桶的单链表，head[键] 为第一项，空桶为 -1
+        // 每次 Update 结束时所有桶都已取空
+        static const int keyLimit = cellCount * maxCost;
+        static const int entryCapacity = 8 * cellCount;
+        int head[keyLimit + 1];
+        int entryCell[entryCapacity], entryNext[entryCapacity];
+        int entryCount, lowKey, highKey;
+        bool overflow;
+
+        bool _otherBase(int cell) const
+        {
+            for (int side = 0; side < Size::sideCount; side++)
+                if (cell != goal && cell == Size::CellIndex(Size::BaseX(side), Size::BaseY(side)))
+                    return true;
+            return false;
+        }
+
+        // 经过某个相邻格子到达目标的代价为 through，比 rhs[cell] 小时更新
+        void _offer(int cell, int through)
+        {
+            if (cell == goal || !cost[cell] || through >= rhs[cell])
+                return;
+            rhs[cell] = (unsigned short)through;
+            _enqueue(cell);
+        }
+
+        // 从头计算 rhs[cell]
+        void _updateCell(int cell)
+        {
+            if (cell == goal)
+                return;
+            int best = unreachable;
+            if (cost[cell])
+                for (int dir = 0; dir < 4; dir++)
+                {
+                    int next = Size::rayTable.neighbor[cell][dir];
+                    if (next >= 0 && cost[next] && distance[next] != unreachable && cost[next] + distance[next] < best)
+                        best = cost[next] + distance[next];
+                }
+            rhs[cell] = (unsigned short)best;
+            _enqueue(cell);
+        }
+
+        // rhs 与 distance 不等（不一致）时入队
+        void _enqueue(int cell)
+        {
+            if (rhs[cell] == distance[cell])
+                return;
+            if (entryCount == entryCapacity)
+            {
+                overflow = true;
+                return;
+            }
+            int key = std::min(rhs[cell], distance[cell]);
+            entryCell[entryCount] = cell;
+            entryNext[entryCount] = head[key];
+            head[key] = entryCount++;
+            lowKey = std::min(lowKey, key);
+            highKey = std::max(highKey, key);
+        }
+
+        void _dial()
+        {
+            for (int cell = 0; cell < cellCount; cell++)
+                distance[cell] = unreachable;
+            distance[goal] = 0;
+            if (!cost[goal])
+                return;
+
+            // 代价不超过 maxCost，用 maxCost + 1 个轮转的桶（Dial 算法）；同一个桶里每个格子至多一项
+            int bucket[maxCost + 1][cellCount], size[maxCost + 1] = { 1 };
+            bucket[0][0] = goal;
+            for (int dist = 0, pending = 1; pending; dist++)
+            {
+                int* current = bucket[dist % (maxCost + 1)];
+                int& count = size[dist % (maxCost + 1)];
+                for (int i = 0; i < count; i++)
+                {
+                    int cell = current[i];
+                    pending--;
+                    if (distance[cell] != dist)
+                        continue;
+                    // 从相邻格子 prev 走进 cell 的代价为 cost[cell]，prev 本身要能途经
+                    int through = dist + cost[cell];
+                    for (int dir = 0; dir < 4; dir++)
+                    {
+                        int prev = Size::rayTable.neighbor[cell][dir];
+                        if (prev >= 0 && cost[prev] && through < distance[prev])
+                        {
+                            distance[prev] = (unsigned short)through;
+                            int b = through % (maxCost + 1);
+                            bucket[b][size[b]++] = prev;
+                            pending++;
+                        }
+                    }
+                }
+                count = 0;
+            }
+        }
+    };
+
+    // 时空预约表：一个坦克照着规划行动时，接下来 horizon 个回合里它所在的格子和子弹经过的格子
+    // 用于两个坦克的协作寻路：先规划的坦克记入预约表，后规划的坦克（见 ActionPlanner::Plan）在窗口内避让它，
+    // 不走到同一格、不挡它的路、不站在它的射线上，也不和它抢同一块砖；窗口之外不再考虑预约
+    template<typename Size>
+    struct BasicReservationTable
+    {
+        typedef typename Size::Bitboard Bitboard;
+
+        // 窗口的回合数
+        static const int horizon = 8;
+
+        // occupied[t] 为第 t 个回合开始时（t = 0 为当前）坦克所在的格子，规划结束之后为空
+        Bitboard occupied[horizon + 2];
+
+        // fire[t] 为第 t 个回合里子弹经过的格子，含射中的砖块
+        Bitboard fire[horizon];
+
+        // 窗口内要射掉的砖块，和 gone[t] 为其中在第 t 个回合开始前已射掉的
+        Bitboard claimed, gone[horizon + 1];
+
+        void Clear()
+        {
+            for (int t = 0; t < horizon + 2; t++)
+                occupied[t] = Bitboard();
+            for (int t = 0; t < horizon; t++)
+                fire[t] = Bitboard();
+            for (int t = 0; t <= horizon; t++)
+                gone[t] = Bitboard();
+            claimed = Bitboard();
+        }
+
+        // 预约的砖块 cell 在第 time 个回合开始时是否已被射掉
+        bool Gone(int cell, int time) const
+        {
+            return time > horizon ? claimed.Test(cell) : gone[time].Test(cell);
+        }
+
+        // 再记下一个从 from 出发照 actions 行动的坦克，brick 和 obstacles 同 ActionPlanner::Plan
+        void Reserve(int from, const Action* actions, int length, const Bitboard& brick, Bitboard obstacles)
+        {
+            int cell = from;
+            Bitboard destroyed = Bitboard();
+            for (int t = 0; t < horizon + 2; t++)
+            {
+                if (t <= horizon)
+                    gone[t] |= destroyed;
+                if (t > length)
+                    continue;
+                occupied[t].Set(cell);
+                if (t == length)
+                    continue;
+                Action act = actions[t];
+                if (ActionIsMove(act))
+                    cell = Size::rayTable.neighbor[cell][act];
+                else if (ActionIsShoot(act) && t < horizon)
+                {
+                    int dir = ExtractDirectionFromAction(act);
+                    int target = Size::FirstObstacle(cell, dir, obstacles);
+                    Bitboard path = Size::rayTable.ray[cell][dir];
+                    if (target >= 0)
+                        path -= Size::rayTable.ray[target][dir];
+                    fire[t] |= path;
+                    if (target >= 0 && brick.Test(target))
+                    {
+                        obstacles.Reset(target);
+                        destroyed.Set(target);
+                    }
+                }
+            }
+            claimed |= destroyed;
+        }
+    };
+
+    // 考虑射击冷却的寻路：状态为（格子，上回合是否射击），规则不允许连续两回合射击
+    // 目标是击中 target（如对方基地）：走到能射中它的格子后射击，不必走到它旁边；
+    // 射线上挡着的砖块可以原地逐个射掉（射击、等一回合、再射击）
+    // 路上的砖块要先射掉再走进去，刚射击过的坦克要先等一回合或先移动；结果是逐回合的动作序列，回合数是精确的
+    // Tank2 里射击不需要朝向，所以没有朝向状态；状态只有 2 * cellCount 个，一次规划在微秒级
+    // 给出预约表时，前 horizon 个回合的状态再按回合分层（时空 A*，见 ReservationTable），可以原地等待给先走的坦克让路，
+    // 默认规模下一次约 15 微秒
+    // 只看当前的场地：走过的路上射掉的砖块只会减少最后要射的次数，不会让被其他障碍挡住的射线变通畅，其他坦克视为不动
+    template<typename Size>
+    struct BasicActionPlanner
+    {
+        typedef typename Size::Bitboard Bitboard;
+        typedef BasicReservationTable<Size> ReservationTable;
+
+        static const int cellCount = Size::cellCount, horizon = ReservationTable::horizon;
+
+        // 每层的状态数，前 horizon 层对应窗口内的回合，最后一层不计回合
+        static const int layerSize = 2 * cellCount, stateCount = (horizon + 1) * layerSize;
+
+        // 射线上最多的格子数
+        static const int maxRayLength = Size::RayTable::maxRayLength;
+
+        // 动作序列的最大长度：窗口内至多 horizon 个回合；之后每个格子至多进入一次，每次至多 3 个动作（等待、射击、移动），
+        // 最后射穿一条射线
+        static const int maxLength = horizon + 3 * cellCount + 2 * maxRayLength;
+
+        // 上次 Plan 找到的动作序列
+        Action actions[maxLength];
+        int length = 0;
+
+        // penalty 的上限
+        static const int maxPenalty = 7;
+
+        // 从 from 出发（shotLastTurn 为上回合射击过）到射中 target 的最少回合数，找不到时返回 -1
+        // brick 为砖块，blocked 为其他不能进入的格子（钢墙、水），obstacles 为挡子弹的格子（水以外的所有物件，含其他坦克），
+        // 不含要规划的坦克本身，但有其他坦克和它同格时 from 仍是障碍（离开后不能再回去）
+        // reserved 不为空时在窗口内避让其中的坦克，此时那些坦克也不应算在 obstacles 里
+        // penalty 不为空时，每个回合结束时待在 cell 上（走进去、原地等待或射击）另加 penalty[cell]（如 ThreatMap::penalty），
+        // 射中目标的最后一个回合除外；返回值为回合数与这些代价之和，回合数见 length
+        int Plan(int from, bool shotLastTurn, int target, const Bitboard& brick, const Bitboard& blocked, const Bitboard& obstacles,
+            const ReservationTable* reserved = nullptr, const unsigned char* penalty = nullptr)
+        {
+            if (++generation == 0)
+            {
+                memset(seen, 0, sizeof(seen));
+                memset(closed, 0, sizeof(closed));
+                generation = 1;
+            }
+            length = 0;
+            this->reserved = reserved;
+            this->target = target;
+            this->penalty = penalty;
+
+            // 预约的砖块留给先走的坦克，射掉之前当作射不穿的墙，射掉之后可以走进去
+            Bitboard bricks = reserved ? brick - reserved->claimed : brick;
+            _findFiringCells(0, target, bricks, obstacles);
+            if (reserved)
+                _findFiringCells(1, target, bricks, obstacles - reserved->claimed);
+
+            // 一步的代价不超过 bucketCount - 1，用轮转的桶；同一个桶里每个状态至多一项
+            // 射中目标的一步可能很长（原地射穿整条射线），不进桶：记下最好的一个，出队的代价不小于它时结束
+            int size[bucketCount] = {};
+            int pending = 0, goalCost = -1;
+            _push(_state(from, shotLastTurn, 0), 0, -1, Stay, 0, Bitboard(), size, pending);
+            for (int dist = 0; pending || goalCost >= 0; dist++)
+            {
+                if (goalCost >= 0 && (goalCost <= dist || !pending))
+                {
+                    _finish();
+                    return goalCost;
+                }
+                int* current = bucket[dist % bucketCount];
+                int& count = size[dist % bucketCount];
+                for (int i = 0; i < count; i++)
+                {
+                    int state = current[i], cell = state % layerSize / 2;
+                    bool shot = state & 1;
+                    pending--;
+                    if (closed[state] == generation || g[state] != dist)
+                        continue;
+                    closed[state] = generation;
+
+                    // 窗口内的状态所在的层就是回合，窗口之外（或没有预约表时）不再需要回合
+                    int time = state / layerSize;
+                    Bitboard done = cleared[state];
+                    if (shot || time < horizon)
+                    {
+                        if (_free(cell, time + 1, false))
+                            _push(_state(cell, false, time + 1), dist + 1 + _penalty(cell), state, Stay, 0, done, size, pending);
+                    }
+                    int k = reserved && time >= horizon;
+                    if (!shot && firingBricks[k][cell] >= 0 && _canFire(cell, time))
+                    {
+                        // 射线上已在路上射掉的砖块不用再射；每射掉一块砖要在 cell 上多待两个回合（射击、等待）
+                        int dir = firingDir[k][cell], bricksLeft = firingBricks[k][cell];
+                        for (Bitboard gone = (Size::rayTable.ray[cell][dir] - Size::rayTable.ray[target][dir]) & bricks & done;
+                            gone.Any(); gone.PopLowest())
+                            bricksLeft--;
+                        int cost = dist + 2 * bricksLeft * (1 + _penalty(cell)) + 1;
+                        if (goalCost < 0 || cost < goalCost)
+                        {
+                            goalCost = cost;
+                            parent[goalState] = state;
+                            step[goalState] = (Action)(dir + UpShoot);
+                            shots[goalState] = bricksLeft;
+                        }
+                    }
+                    for (int dir = 0; dir < 4; dir++)
+                    {
+                        int next = Size::rayTable.neighbor[cell][dir];
+                        if (next < 0 || blocked.Test(next))
+                            continue;
+                        if (!obstacles.Test(next) || done.Test(next) || (reserved && reserved->Gone(next, time)))
+                        {
+                            if (_free(next, time + 1, true))
+                                _push(_state(next, false, time + 1), dist + 1 + _penalty(next), state, (Action)dir, 0, done,
+                                    size, pending);
+                        }
+                        else if (bricks.Test(next) && !shot && _free(cell, time + 1, false) && _free(next, time + 2, true))
+                        {
+                            Bitboard after = done;
+                            after.Set(next);
+                            _push(_state(next, false, time + 2), dist + 2 + _penalty(cell) + _penalty(next), state,
+                                (Action)dir, 1, after, size, pending);
+                        }
+                    }
+                }
+                count = 0;
+            }
+            return -1;
+        }
+
+    private:
+        static const int goalState = stateCount;
+
+        // 进桶的一步的代价至多为走进砖块（射击、移动）的 2 + 2 * maxPenalty
+        static const int bucketCount = 2 * maxPenalty + 3;
+
+        int bucket[bucketCount][stateCount];
+
+        // seen[state] == generation 时 g、parent、step、shots、cleared 有效，closed[state] == generation 时已出队
+        // 状态 goalState 表示已射中目标，只用 parent、step、shots
+        int g[stateCount + 1], parent[stateCount + 1];
+
+        // 进入该状态的最后一个动作，和在它之前的射击次数：
+        // 走进砖块为先射击一次再移动；射中目标为原地射击 shots 次（每两次之间等一回合），最后一次射中目标
+        Action step[stateCount + 1];
+        int shots[stateCount + 1];
+
+        // 到达该状态的路上已经射掉的砖块，之后再经过时直接走进去
+        // 只在窗口内有意义：那里可以等待或绕回来，同一个格子会按回合分成多个状态
+        Bitboard cleared[stateCount + 1];
+
+        unsigned seen[stateCount + 1] = {}, closed[stateCount + 1] = {};
+        unsigned generation = 0;
+
+        const ReservationTable* reserved = nullptr;
+        const unsigned char* penalty = nullptr;
+        int target = -1;
+
+        int _penalty(int cell) const
+        {
+            return penalty ? std::min((int)penalty[cell], (int)maxPenalty) : 0;
+        }
+
+        // 没有预约表时只用最后一层
+        int _state(int cell, bool shot, int time) const
+        {
+            int layer = reserved && time < horizon ? time : horizon;
+            return layer * layerSize + cell * 2 + shot;
+        }
+
+        // 第 time 个回合开始时（moved 为刚走进来）待在 cell 是否不与预约冲突：
+        // 不和那个坦克同格，不占它下一回合要走进的格子，不走进它刚离开的格子，不在它的子弹经过的格子上
+        bool _free(int cell, int time, bool moved) const
+        {
+            if (!reserved || time > horizon)
+                return true;
+            return !reserved->occupied[time].Test(cell) && !reserved->occupied[time + 1].Test(cell) &&
+                !reserved->fire[time - 1].Test(cell) && !(moved && reserved->occupied[time - 1].Test(cell));
+        }
+
+        // 从第 time 个回合起在 cell 原地射向目标，射击期间是否不与预约冲突：自己不被挡、不被打，也不打中那个坦克
+        bool _canFire(int cell, int time) const
+        {
+            if (!reserved || time >= horizon)
+                return true;
+            int dir = firingDir[0][cell];
+            Bitboard line = Size::rayTable.ray[cell][dir] - Size::rayTable.ray[target][dir];
+            for (int t = time + 1; t <= time + 2 * firingBricks[0][cell] + 1 && t <= horizon; t++)
+                if (!_free(cell, t, false) || (line & reserved->occupied[t]).Any())
+                    return false;
+            return true;
+        }
+
+        void _push(int state, int cost, int from, Action act, int shotsBefore, const Bitboard& clearedBefore,
+            int (&size)[bucketCount], int& pending)
+        {
+            if (closed[state] == generation || (seen[state] == generation && g[state] <= cost))
+                return;
+            seen[state] = generation;
+            g[state] = cost;
+            parent[state] = from;
+            step[state] = act;
+            shots[state] = shotsBefore;
+            cleared[state] = clearedBefore;
+            bucket[cost % bucketCount][size[cost % bucketCount]++] = state;
+            pending++;
+        }
+
+        // 能射中目标的格子：firingBricks[k][cell] 为从 cell 射向目标时中间要先射掉的砖块数，不能射中时为 -1
+        // k = 1 为窗口之后，预约的砖块已被射掉；没有预约表时只用 k = 0
+        int firingBricks[2][cellCount], firingDir[2][cellCount];
+
+        // 从 target 沿四个方向往外走，经过砖块时计数，遇到其他障碍为止
+        void _findFiringCells(int k, int target, const Bitboard& brick, const Bitboard& walls)
+        {
+            for (int cell = 0; cell < cellCount; cell++)
+                firingBricks[k][cell] = -1;
+            for (int dir = 0; dir < 4; dir++)
+            {
+                int bricks = 0;
+                for (int i = 0; i < Size::rayTable.length[target][dir]; i++)
+                {
+                    int cell = Size::rayTable.cells[target][dir].cell[i];
+                    if (walls.Test(cell) && !brick.Test(cell))
+                        break;
+                    // 站在砖块所在的格子上（射掉并走进去之后）时，这块砖不在射线上
+                    firingBricks[k][cell] = bricks;
+                    firingDir[k][cell] = (dir + 2) % 4;
+                    bricks += brick.Test(cell);
+                }
+            }
+        }
+
+        // 从 goalState 沿 parent 倒推出动作序列（有 penalty 时代价不等于回合数，先数出回合数）
+        void _finish()
+        {
+            length = 2 * shots[goalState] + 1;
+            for (int state = parent[goalState]; parent[state] >= 0; state = parent[state])
+                length += 1 + shots[state];
+            int i = length;
+            actions[--i] = step[goalState];
+            for (int k = 0; k < shots[goalState]; k++)
+            {
+                actions[--i] = Stay;
+                actions[--i] = step[goalState];
+            }
+            for (int state = parent[goalState]; parent[state] >= 0; state = parent[state])
+            {
+                actions[--i] = step[state];
+                if (shots[state])
+                    actions[--i] = (Action)(step[state] + UpShoot);
+            }
+        }
+    };
+
+    // 紧凑的局面快照，只包含规则需要的信息
+    // 可以平凡复制，默认规模下不超过一个缓存行，供 copy-make 式的搜索（MCTS、极大极小）使用
+    template<int Height, int Width, int Sides, int Tanks>
+    struct BasicTankState
+    {
+        typedef FieldSize<Height, Width, Sides, Tanks> Size;
+        typedef typename Size::Bitboard Bitboard;
+        typedef typename Size::TankMask TankMask;
+        typedef BasicJointAction<Sides, Tanks> JointAction;
+        typedef BasicActionSymmetry<Sides, Tanks> ActionSymmetry;
+        typedef BasicZobristTable<Size> ZobristTable;
+        typedef BasicAttackMap<Size> AttackMap;
+
+        static const int sideCount = Sides, tankPerSide = Tanks;
+
+        Bitboard brick, steel, water;
+
+        // 坦克所在格子的编号，-1表示坦克已炸
+        typename Size::CellType tankCell[Sides][Tanks];
+
+        // 第 side 位表示该方基地存活
+        TankMask baseAlive;
+
+        // 上回合射击过的坦克（第 side * tankPerSide + tank 位）
+        TankMask lastShot;
+
+        // 当前回合编号
+        unsigned char turn;
+
+        // 所有物件占据的格子
+        Bitboard Occupied() const
+        {
+            Bitboard all = brick | steel | water;
+            for (int side = 0; side < sideCount; side++)
+            {
+                if (baseAlive >> side & 1)
+                    all.Set(Size::CellIndex(Size::BaseX(side), Size::BaseY(side)));
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    if (tankCell[side][tank] >= 0)
+                        all.Set(tankCell[side][tank]);
+            }
+            return all;
+        }
+
+        // 判断行为是否合法（出界或移动到非空格子算作非法）
+        // 未考虑坦克是否存活
+        bool ActionIsValid(int side, int tank, Action act) const
+        {
+            return _actionIsValid(side, tank, act, Occupied());
+        }
+
+        // 一次算出所有坦克的合法动作掩码（见 ActionBit），pruning 为 ActionPruning 的组合
+        // 已炸的坦克的任何动作都会被 DoAction 接受
+        // 带 PruneSymmetric 时把镜像关系写入 symmetry，交给 JointActionIterator 使用
+        void GetLegalActionMasks(unsigned short (&masks)[Sides][Tanks], int pruning = PruneNone,
+            ActionSymmetry* symmetry = nullptr) const
+        {
+            Bitboard occupied = Occupied();
+
+            // 射击结算前坦克可能到达的格子，用于判断射击是否可能打到东西
+            Bitboard tankReach = {};
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    int cell = tankCell[side][tank];
+                    if (cell < 0)
+                    {
+                        masks[side][tank] = pruning & PruneDeadTanks ? ActionBit(Stay) : allActionsMask;
+                        continue;
+                    }
+                    unsigned short mask = ActionBit(Stay);
+                    tankReach.Set(cell);
+                    for (int dir = 0; dir < 4; dir++)
+                    {
+                        const Bitboard& step = Size::rayTable.step[cell][dir];
+                        if (step.Any() && !(step & occupied).Any())
+                        {
+                            mask |= ActionBit((Action)dir);
+                            tankReach |= step;
+                        }
+                    }
+                    masks[side][tank] = mask;
+                }
+
+            // 保留下来的那个打不到东西的射击，镜像中被剪掉的射击换成它
+            Action keptUseless[Sides][Tanks];
+            Bitboard targets = (occupied - water) | tankReach;
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    keptUseless[side][tank] = Invalid;
+                    int cell = tankCell[side][tank];
+                    if (cell < 0 || (lastShot >> (side * tankPerSide + tank) & 1)) // 连续两回合射击
+                        continue;
+                    for (int dir = 0; dir < 4; dir++)
+                    {
+                        if ((pruning & PruneUselessShots) && !(Size::rayTable.ray[cell][dir] & targets).Any())
+                        {
+                            if (keptUseless[side][tank] != Invalid)
+                                continue;
+                            keptUseless[side][tank] = (Action)(dir + UpShoot);
+                        }
+                        masks[side][tank] |= ActionBit((Action)(dir + UpShoot));
+                    }
+                }
+
+            if (!symmetry)
+                return;
+            symmetry->active = (pruning & PruneSymmetric) && _mirrorPartners(symmetry->partner);
+            if (!symmetry->active)
+                return;
+            for (int i = 0; i < Sides * Tanks; i++)
+            {
+                int to = symmetry->partner[i];
+                for (int act = Stay; act <= LeftShoot; act++)
+                {
+                    Action image = Size::SymmetricAction((Action)act, 1);
+                    if (!(masks[to / Tanks][to % Tanks] & ActionBit(image)))
+                        image = keptUseless[to / Tanks][to % Tanks];
+                    symmetry->image[i][act - Stay] = image;
+                }
+            }
+        }
+
+        // 执行联合动作并进入下一回合，返回行为是否合法（不合法时局面不变）
+        // 忽略掉未存活的坦克
+        bool Apply(const JointAction& joint)
+        {
+            if (turn > turnCapacity)
+                return false;
+            Bitboard occupied = Occupied();
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    if (tankCell[side][tank] >= 0 && !_actionIsValid(side, tank, joint.act[side][tank], occupied))
+                        return false;
+
+            // 1 移动
+            TankMask shots = 0;
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    Action act = joint.act[side][tank];
+                    if (ActionIsShoot(act))
+                        shots |= 1 << (side * tankPerSide + tank);
+                    if (tankCell[side][tank] >= 0 && ActionIsMove(act))
+                        tankCell[side][tank] = Size::rayTable.neighbor[tankCell[side][tank]][act];
+                }
+
+            // 2 射击
+            Bitboard hit = Size::ResolveShots(tankCell, joint.act, Occupied() - water);
+
+            // 3 摧毁
+            brick -= hit;
+            for (int side = 0; side < sideCount; side++)
+            {
+                if (hit.Test(Size::CellIndex(Size::BaseX(side), Size::BaseY(side))))
+                    baseAlive &= ~(1 << side);
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    if (tankCell[side][tank] >= 0 && hit.Test(tankCell[side][tank]))
+                        tankCell[side][tank] = -1;
+            }
+
+            lastShot = shots;
+            turn++;
+            return true;
+        }
+
+        // 游戏是否结束？谁赢了？
+        GameResult GetGameResult() const
+        {
+            return Size::JudgeResult(_tanksLost() | (~baseAlive & ((1u << Sides) - 1)), turn > maxTurn);
+        }
+
+        // 游戏结束的原因，未结束时为 NotEnded
+        GameEndReason GetEndReason() const
+        {
+            return Size::JudgeEndReason(~baseAlive & ((1u << Sides) - 1), _tanksLost(), turn > maxTurn);
+        }
+
+        // 计算当前局面的攻击图
+        void GetAttackMap(AttackMap& map) const
+        {
+            map.Compute(tankCell, ~lastShot & ((1u << Size::tankCount) - 1), Occupied() - water);
+        }
+
+        // 对称变换（见 FieldSize::symmetryCount）后的局面，坦克保持原来的编号
+        BasicTankState Transformed(int symmetry) const
+        {
+            static_assert(Sides == 2 && Width % 2 == 1, "symmetries need two sides and a middle column");
+            BasicTankState t = *this;
+            t.brick = _transform(brick, symmetry);
+            t.steel = _transform(steel, symmetry);
+            t.water = _transform(water, symmetry);
+            t.baseAlive = t.lastShot = 0;
+            for (int side = 0; side < sideCount; side++)
+            {
+                int to = Size::SymmetricSide(side, symmetry);
+                t.baseAlive |= (baseAlive >> side & 1) << to;
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    int cell = tankCell[side][tank];
+                    t.tankCell[to][tank] = cell < 0 ? -1 : Size::SymmetricCell(cell, symmetry);
+                    t.lastShot |= (lastShot >> (side * tankPerSide + tank) & 1) << (to * tankPerSide + tank);
+                }
+            }
+            return t;
+        }
+
+        // 与 Transformed 配套的联合动作：先变换再 Apply 与先 Apply 再变换得到同一个局面
+        static JointAction TransformedAction(const JointAction& joint, int symmetry)
+        {
+            JointAction t;
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    t.act[Size::SymmetricSide(side, symmetry)][tank] = Size::SymmetricAction(joint.act[side][tank], symmetry);
+            return t;
+        }
+
+        // 对称等价的局面共用的键：取各个对称变换下键的最小值，同一方坦克的编号不计入
+        // 与 TankField::hash 一样不含回合编号；symmetry 非空时存入取到最小值的变换，
+        // 用 Transformed / TransformedAction 把局面和动作换到规范形式（置换表、开局库里按规范形式存放）
+        unsigned long long CanonicalKey(int* symmetry = nullptr) const
+        {
+            static_assert(Sides == 2 && Width % 2 == 1, "symmetries need two sides and a middle column");
+            const ZobristTable& z = ZobristTable::table;
+
+            // 各物件的键相加（同一方的两个坦克可能在同一格，不能用异或）
+            unsigned long long key[Size::symmetryCount] = {};
+            const Bitboard* boards[3] = { &brick, &steel, &water };
+            const int items[3] = { 0, 1, 7 }; // Brick、Steel、Water 的位序号
+            for (int i = 0; i < 3; i++)
+                for (Bitboard b = *boards[i]; b.Any();)
+                {
+                    int cell = b.PopLowest();
+                    for (int sym = 0; sym < Size::symmetryCount; sym++)
+                        key[sym] += z.item[Size::SymmetricCell(cell, sym)][items[i]];
+                }
+            for (int side = 0; side < sideCount; side++)
+            {
+                int base = Size::CellIndex(Size::BaseX(side), Size::BaseY(side));
+                if (baseAlive >> side & 1)
+                    for (int sym = 0; sym < Size::symmetryCount; sym++)
+                        key[sym] += z.item[Size::SymmetricCell(base, sym)][2];
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    int cell = tankCell[side][tank], shot = lastShot >> (side * tankPerSide + tank) & 1;
+                    if (cell >= 0)
+                        for (int sym = 0; sym < Size::symmetryCount; sym++)
+                            key[sym] += z.tank[Size::SymmetricCell(cell, sym)][Size::SymmetricSide(side, sym)][shot];
+                }
+            }
+
+            int best = 0;
+            for (int sym = 1; sym < Size::symmetryCount; sym++)
+                if (key[sym] < key[best])
+                    best = sym;
+            if (symmetry)
+                *symmetry = best;
+            return key[best];
+        }
+
+    private:
+        static Bitboard _transform(Bitboard b, int symmetry)
+        {
+            Bitboard t = {};
+            while (b.Any())
+                t.Set(Size::SymmetricCell(b.PopLowest(), symmetry));
+            return t;
+        }
+
+        // 局面左右镜像后不变（同一方的坦克可以交换编号）时，给出每个坦克在镜像中对应的坦克
+        // 相同的坦克按编号顺序配对，保证 partner 是对合，迭代器据此在互为镜像的联合动作中只取一个
+        bool _mirrorPartners(int (&partner)[Sides * Tanks]) const
+        {
+            if (Width % 2 == 0 || _transform(brick, 1) != brick || _transform(steel, 1) != steel || _transform(water, 1) != water)
+                return false;
+            for (int side = 0; side < sideCount; side++)
+            {
+                bool used[Tanks] = {};
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    int cell = tankCell[side][tank], shot = lastShot >> (side * tankPerSide + tank) & 1;
+                    int image = cell < 0 ? -1 : Size::SymmetricCell(cell, 1), other = 0;
+                    while (other < tankPerSide && (used[other] || tankCell[side][other] != image ||
+                        (int)(lastShot >> (side * tankPerSide + other) & 1) != shot))
+                        other++;
+                    if (other == tankPerSide)
+                        return false;
+                    used[other] = true;
+                    partner[side * tankPerSide + tank] = side * tankPerSide + other;
+                }
+            }
+            return true;
+        }
+
+        // 坦克全炸的各方
+        unsigned _tanksLost() const
+        {
+            unsigned lost = 0;
+            for (int side = 0; side < sideCount; side++)
+            {
+                bool tankAlive = false;
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    tankAlive |= tankCell[side][tank] >= 0;
+                if (!tankAlive)
+                    lost |= 1u << side;
+            }
+            return lost;
+        }
+
+        bool _actionIsValid(int side, int tank, Action act, const Bitboard& occupied) const
+        {
+            if (act == Invalid)
+                return false;
+            if (act > Left && (lastShot >> (side * tankPerSide + tank) & 1)) // 连续两回合射击
+                return false;
+            if (act == Stay || act > Left)
+                return true;
+            int cell = tankCell[side][tank];
+            if (cell < 0)
+                return false;
+            const Bitboard& step = Size::rayTable.step[cell][act];
+            return step.Any() && !(step & occupied).Any();
+        }
+    };
+
+#ifdef _MSC_VER
+#pragma endregion
+
+#pragma region TankField 主要逻辑类
+#endif
+
+    template<int Height, int Width, int Sides, int Tanks>
+    class BasicTankField
+    {
+    public:
+        typedef FieldSize<Height, Width, Sides, Tanks> Size;
+        typedef typename Size::Bitboard Bitboard;
+        typedef BasicTankState<Height, Width, Sides, Tanks> TankState;
+        typedef BasicZobristTable<Size> ZobristTable;
+        typedef BasicAttackMap<Size> AttackMap;
+        typedef BasicTurnPreview<Size> TurnPreview;
+        typedef BasicJointAction<Sides, Tanks> JointAction;
+        typedef BasicDisappearLog<Size> DisappearLog;
+
+        static const int fieldHeight = Height, fieldWidth = Width, sideCount = Sides, tankPerSide = Tanks;
+
+        //!//!//!// 以下变量设计为只读，不推荐进行修改 //!//!//!//
+
+        // 游戏场地上的物件（一个格子上可能有多个坦克）
+        FieldItem gameField[fieldHeight][fieldWidth] = {};
+
+        // 坦克是否存活
+        bool tankAlive[sideCount][tankPerSide];
+
+        // 基地是否存活
+        bool baseAlive[sideCount];
+
+        // 坦克横坐标，-1表示坦克已炸
+        int tankX[sideCount][tankPerSide];
+
+        // 坦克纵坐标，-1表示坦克已炸
+        int tankY[sideCount][tankPerSide];
+
+        // 当前回合编号
+        int currentTurn = 1;
+
+        // 我是哪一方
+        int mySide;
+
+        // 用于回退的log：第 t 回合的记录是 logs[logStart[t]] 到 logs[logCount - 1]（或下一回合的开头）
+        // 定长数组，DoAction / Revert 不申请内存
+        DisappearLog logs[turnCapacity * Size::maxLogPerTurn];
+        int logCount = 0;
+        unsigned short logStart[turnCapacity + 1] = {};
+        static_assert(turnCapacity * Size::maxLogPerTurn <= 0xFFFF, "logStart must fit in 16 bits");
+
+        // 只保存上一回合的动作时，第 t 回合执行前上一回合射击过的坦克，Revert 回到第 t 回合时用它补回被覆盖的动作
+        typename Size::TankMask shotsBefore[fullActionHistory ? 1 : turnCapacity + 1] = {};
+
+        // 能回退到的最早回合（从快照导入后为导入时的回合）
+        int firstTurn = 1;
+
+        // 会挡住子弹的格子（水以外有物件的格子），与 gameField 同步维护，配合 FirstObstacle 使用
+        Bitboard obstacles = {};
+
+        // 局面的 Zobrist 哈希（场地物件 + 上回合射击过的存活坦克，不含回合编号），由 DoAction / Revert 增量维护
+        unsigned long long hash = 0;
+
+        // 各方存活的坦克数
+        int tankAliveCount[sideCount];
+
+        // 基地被炸、坦克全炸的各方（第 side 位），与上面的两个数组一起由 DoAction / Revert 增量维护
+        unsigned baseLost = 0, tanksLost = 0;
+
+        //!//!//!// 以上变量设计为只读，不推荐进行修改 //!//!//!//
+
+        // 本回合双方即将执行的动作，需要手动填入
+        Action nextAction[sideCount][tankPerSide];
+
+        // 计算本回合的攻击图（同 TankState::GetAttackMap）
+        // 不在场地里缓存，多个线程可以同时查询同一个只读的场地；需要反复查询时由调用者保存结果
+        void GetAttackMap(AttackMap& map) const
+        {
+            int tankCell[sideCount][tankPerSide];
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    tankCell[side][tank] = tankAlive[side][tank] ? Size::CellIndex(tankX[side][tank], tankY[side][tank]) : -1;
+            map.Compute(tankCell, ~(unsigned)LastShots(), obstacles);
+        }
+
+        // 第 turn 回合 side 方 tank 号坦克的动作（第 0 回合为 Stay）
+        // 定义了 TANK2_RULES_ONLY_HISTORY 时只能查询上一回合，即 turn == currentTurn - 1
+        Action PreviousAction(int turn, int side, int tank) const
+        {
+            return actionHistory.Get(turn, side, tank);
+        }
+
+        // 上回合射击过的坦克（第 side * tankPerSide + tank 位），由动作历史得出，规则只需要它
+        typename Size::TankMask LastShots() const
+        {
+            typename Size::TankMask shots = 0;
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    shots |= _shotLastTurn(side, tank) << (side * tankPerSide + tank);
+            return shots;
+        }
+
+        // 判断行为是否合法（出界或移动到非空格子算作非法）
+        // 未考虑坦克是否存活
+        bool ActionIsValid(int side, int tank, Action act) const
+        {
+            if (act == Invalid)
+                return false;
+            if (act > Left && _shotLastTurn(side, tank)) // 连续两回合射击
+                return false;
+            if (act == Stay || act > Left)
+                return true;
+            int x = tankX[side][tank] + dx[act],
+                y = tankY[side][tank] + dy[act];
+            return Size::CoordValid(x, y) && gameField[y][x] == None;// water cannot be stepped on
+        }
+
+        // 判断 nextAction 中的所有行为是否都合法
+        // 忽略掉未存活的坦克
+        bool ActionIsValid() const
+        {
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    if (tankAlive[side][tank] && !ActionIsValid(side, tank, nextAction[side][tank]))
+                        return false;
+            return true;
+        }
+
+        // 从头计算局面哈希，结果应与 hash 相同
+        unsigned long long ComputeHash() const
+        {
+            unsigned long long key = _shotHash();
+            for (int y = 0; y < fieldHeight; y++)
+                for (int x = 0; x < fieldWidth; x++)
+                    key ^= ZobristTable::table.Cell(x, y, gameField[y][x]);
+            return key;
+        }
+
+    private:
+        void _destroyBase(int side)
+        {
+            baseAlive[side] = false;
+            baseLost |= 1u << side;
+        }
+
+        void _revertBase(int side)
+        {
+            baseAlive[side] = true;
+            baseLost &= ~(1u << side);
+        }
+
+        void _destroyTank(int side, int tank)
+        {
+            tankAlive[side][tank] = false;
+            tankX[side][tank] = tankY[side][tank] = -1;
+            if (--tankAliveCount[side] == 0)
+                tanksLost |= 1u << side;
+        }
+
+        void _revertTank(int side, int tank, DisappearLog& log)
+        {
+            int &currX = tankX[side][tank], &currY = tankY[side][tank];
+            FieldItem item = Size::TankItem(side, tank);
+            if (tankAlive[side][tank])
+            {
+                gameField[currY][currX] &= ~item;
+                hash ^= ZobristTable::table.Cell(currX, currY, item);
+                _syncObstacle(currX, currY);
+            }
+            else
+            {
+                tankAlive[side][tank] = true;
+                if (tankAliveCount[side]++ == 0)
+                    tanksLost &= ~(1u << side);
+            }
+            currX = log.X();
+            currY = log.Y();
+            gameField[currY][currX] |= item;
+            hash ^= ZobristTable::table.Cell(currX, currY, item);
+            obstacles.Set(Size::CellIndex(currX, currY));
+        }
+
+        // 动作历史，见 PreviousAction
+        BasicActionHistory<Sides, Tanks, fullActionHistory ? turnCapacity + 1 : 1> actionHistory;
+
+        bool _shotLastTurn(int side, int tank) const
+        {
+            return ActionIsShoot(actionHistory.Get(currentTurn - 1, side, tank));
+        }
+
+        // 上一回合的动作已被覆盖（或从快照导入）时，按 shots（同 LastShots）补上：射击过的记为 UpShoot，其余记为 Stay
+        void _restoreLastActions(typename Size::TankMask shots)
+        {
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    actionHistory.Set(currentTurn - 1, side, tank, (shots >> (side * tankPerSide + tank) & 1) ? UpShoot : Stay);
+        }
+
+        // 从头计算 tankAliveCount、baseLost 和 tanksLost
+        void _syncLost()
+        {
+            baseLost = tanksLost = 0;
+            for (int side = 0; side < sideCount; side++)
+            {
+                tankAliveCount[side] = 0;
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    tankAliveCount[side] += tankAlive[side][tank];
+                if (!baseAlive[side])
+                    baseLost |= 1u << side;
+                if (!tankAliveCount[side])
+                    tanksLost |= 1u << side;
+            }
+        }
+
+        void _syncAllObstacles()
+        {
+            for (int y = 0; y < fieldHeight; y++)
+                for (int x = 0; x < fieldWidth; x++)
+                    _syncObstacle(x, y);
+        }
+
+        void _syncObstacle(int x, int y)
+        {
+            if (gameField[y][x] & ~Water)
+                obstacles.Set(Size::CellIndex(x, y));
+            else
+                obstacles.Reset(Size::CellIndex(x, y));
+        }
+
+        // 上回合射击过的存活坦克的键
+        unsigned long long _shotHash() const
+        {
+            unsigned long long key = 0;
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    if (tankAlive[side][tank] && _shotLastTurn(side, tank))
+                        key ^= ZobristTable::table.shot[side][tank];
+            return key;
+        }
+
+        // 基地所在格子属于哪一方
+        static int _baseSide(int x, int y)
+        {
+            for (int side = 0; side < sideCount; side++)
+                if (x == Size::BaseX(side) && y == Size::BaseY(side))
+                    return side;
+            return -1;
+        }
+    public:
+
+        // 执行 nextAction 中指定的行为并进入下一回合，返回行为是否合法
+        bool DoAction()
+        {
+            if (currentTurn > turnCapacity || !ActionIsValid())
+                return false;
+
+            logStart[currentTurn] = (unsigned short)logCount;
+            hash ^= _shotHash();
+            if (!fullActionHistory)
+                shotsBefore[currentTurn] = LastShots();
+
+            // 1 移动
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    Action act = nextAction[side][tank];
+
+                    // 保存动作
+                    actionHistory.Set(currentTurn, side, tank, act);
+                    if (tankAlive[side][tank] && ActionIsMove(act))
+                    {
+                        int &x = tankX[side][tank], &y = tankY[side][tank];
+                        FieldItem &items = gameField[y][x];
+
+                        // 记录 Log
+                        DisappearLog log = DisappearLog::Make(Size::TankItem(side, tank), Size::CellIndex(x, y));
+                        logs[logCount++] = log;
+
+                        // 变更坐标
+                        x += dx[act];
+                        y += dy[act];
+
+                        // 更换标记（注意格子可能有多个坦克）
+                        gameField[y][x] |= log.Item();
+                        items &= ~log.Item();
+                        hash ^= ZobristTable::table.Cell(log.X(), log.Y(), log.Item()) ^ ZobristTable::table.Cell(x, y, log.Item());
+                        obstacles.Set(Size::CellIndex(x, y));
+                        _syncObstacle(log.X(), log.Y());
+                    }
+                }
+
+            // 2 射♂击!
+            // 被击中的格子，格子上的物件之后一起摧毁（同一格子被多次击中也只处理一次）
+            Bitboard hitCells = {};
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    Action act = nextAction[side][tank];
+                    if (tankAlive[side][tank] && ActionIsShoot(act))
+                    {
+                        int x = tankX[side][tank], y = tankY[side][tank];
+                        bool hasMultipleTankWithMe = HasMultipleTank(gameField[y][x]);
+
+                        // 水不挡子弹，射线上第一个有其他物件的格子就是击中的格子
+                        int target = Size::FirstObstacle(Size::CellIndex(x, y), ExtractDirectionFromAction(act), obstacles);
+                        if (target < 0)
+                            continue;
+                        FieldItem items = gameField[Size::CellY(target)][Size::CellX(target)];
+
+                        // 对射判断
+                        if (items >= Blue0 &&
+                            !hasMultipleTankWithMe && !HasMultipleTank(items))
+                        {
+                            // 自己这里和射到的目标格子都只有一个坦克
+                            Action theirAction = nextAction[Size::GetTankSide(items)][Size::GetTankID(items)];
+                            if (ActionIsShoot(theirAction) &&
+                                ActionDirectionIsOpposite(act, theirAction))
+                            {
+                                // 而且我方和对方的射击方向是反的
+                                // 那么就忽视这次射击
+                                continue;
+                            }
+                        }
+
+                        // 标记这个格子上的物件要被摧毁了
+                        hitCells.Set(target);
+                    }
+                }
+
+            while (hitCells.Any())
+            {
+                int cell = hitCells.PopLowest();
+                FieldItem items = gameField[Size::CellY(cell)][Size::CellX(cell)];
+                for (int i = 0; i < Size::itemTypeCount; i++)
+                {
+                    int mask = 1 << i;
+                    if (!(items & mask) || mask == Water)
+                        continue;
+                    DisappearLog log = DisappearLog::Make((FieldItem)mask, cell);
+                    switch (log.Item())
+                    {
+                    case Base:
+                        _destroyBase(_baseSide(log.X(), log.Y()));
+                        break;
+                    case Brick:
+                        break;
+                    case Steel:
+                        continue;
+                    default:
+                        _destroyTank(Size::GetTankSide(log.Item()), Size::GetTankID(log.Item()));
+                    }
+                    gameField[log.Y()][log.X()] &= ~log.Item();
+                    hash ^= ZobristTable::table.Cell(log.X(), log.Y(), log.Item());
+                    _syncObstacle(log.X(), log.Y());
+                    logs[logCount++] = log;
+                }
+            }
+
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    nextAction[side][tank] = Invalid;
+
+            currentTurn++;
+            hash ^= _shotHash();
+            return true;
+        }
+
+        // 不修改场地（包括 nextAction 和回退记录），算出执行 joint 之后的变化，规则与 DoAction 相同
+        // 只读取场地，多个线程可以同时对同一个场地调用
+        TurnPreview Preview(const JointAction& joint) const
+        {
+            TurnPreview preview;
+            preview.valid = currentTurn <= turnCapacity;
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    if (tankAlive[side][tank] && !ActionIsValid(side, tank, joint.act[side][tank]))
+                        preview.valid = false;
+            if (!preview.valid)
+                return preview;
+
+            // 1 移动：有坦克的格子上只有坦克，先去掉所有坦克再放回移动后的位置
+            Bitboard moved = obstacles;
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    int& cell = preview.tankCell[side][tank];
+                    cell = -1;
+                    if (!tankAlive[side][tank])
+                        continue;
+                    cell = Size::CellIndex(tankX[side][tank], tankY[side][tank]);
+                    moved.Reset(cell);
+                    if (ActionIsMove(joint.act[side][tank]))
+                        cell = Size::rayTable.neighbor[cell][joint.act[side][tank]];
+                }
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    if (preview.tankCell[side][tank] >= 0)
+                        moved.Set(preview.tankCell[side][tank]);
+
+            // 2 射击
+            preview.hit = Size::ResolveShots(preview.tankCell, joint.act, moved);
+
+            // 3 摧毁
+            preview.destroyedBricks = Bitboard();
+            for (Bitboard b = preview.hit; b.Any();)
+            {
+                int cell = b.PopLowest();
+                if (gameField[Size::CellY(cell)][Size::CellX(cell)] & Brick)
+                    preview.destroyedBricks.Set(cell);
+            }
+            unsigned newBaseLost = baseLost, newTanksLost = 0;
+            preview.destroyedTanks = preview.destroyedBases = 0;
+            for (int side = 0; side < sideCount; side++)
+            {
+                if (baseAlive[side] && preview.hit.Test(Size::CellIndex(Size::BaseX(side), Size::BaseY(side))))
+                {
+                    preview.destroyedBases |= 1u << side;
+                    newBaseLost |= 1u << side;
+                }
+                bool anyTank = false;
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    int& cell = preview.tankCell[side][tank];
+                    if (cell >= 0 && preview.hit.Test(cell))
+                    {
+                        preview.destroyedTanks |= 1u << (side * tankPerSide + tank);
+                        cell = -1;
+                    }
+                    anyTank |= cell >= 0;
+                }
+                if (!anyTank)
+                    newTanksLost |= 1u << side;
+            }
+            preview.result = Size::JudgeResult(newBaseLost | newTanksLost, currentTurn + 1 > maxTurn);
+            preview.endReason = Size::JudgeEndReason(newBaseLost, newTanksLost, currentTurn + 1 > maxTurn);
+            return preview;
+        }
+
+        // 回到上一回合
+        bool Revert()
+        {
+            if (currentTurn == firstTurn)
+                return false;
+
+            hash ^= _shotHash();
+            currentTurn--;
+            if (!fullActionHistory)
+                _restoreLastActions(shotsBefore[currentTurn]);
+            // 倒序撤销这一回合的全部记录
+            while (logCount > logStart[currentTurn])
+            {
+                DisappearLog& log = logs[--logCount];
+                switch (log.Item())
+                {
+                case Base:
+                    _revertBase(_baseSide(log.X(), log.Y()));
+                    gameField[log.Y()][log.X()] = Base;
+                    hash ^= ZobristTable::table.Cell(log.X(), log.Y(), Base);
+                    obstacles.Set(Size::CellIndex(log.X(), log.Y()));
+                    break;
+                case Brick:
+                    gameField[log.Y()][log.X()] = Brick;
+                    hash ^= ZobristTable::table.Cell(log.X(), log.Y(), Brick);
+                    obstacles.Set(Size::CellIndex(log.X(), log.Y()));
+                    break;
+                default:
+                    _revertTank(Size::GetTankSide(log.Item()), Size::GetTankID(log.Item()), log);
+                }
+            }
+            hash ^= _shotHash();
+            return true;
+        }
+
+        // 游戏是否结束？谁赢了？只读取增量维护的 baseLost / tanksLost，不扫描局面
+        GameResult GetGameResult() const
+        {
+            return Size::JudgeResult(baseLost | tanksLost, currentTurn > maxTurn);
+        }
+
+        // 游戏结束的原因，未结束时为 NotEnded
+        GameEndReason GetEndReason() const
+        {
+            return Size::JudgeEndReason(baseLost, tanksLost, currentTurn > maxTurn);
+        }
+
+        // 对称规范化的键，见 TankState::CanonicalKey
+        unsigned long long CanonicalKey(int* symmetry = nullptr) const
+        {
+            TankState state;
+            ExportState(state);
+            return state.CanonicalKey(symmetry);
+        }
+
+        // 导出为紧凑快照
+        void ExportState(TankState& state) const
+        {
+            state = TankState();
+            for (int y = 0; y < fieldHeight; y++)
+                for (int x = 0; x < fieldWidth; x++)
+                {
+                    if (gameField[y][x] & Brick)
+                        state.brick.Set(Size::CellIndex(x, y));
+                    else if (gameField[y][x] & Steel)
+                        state.steel.Set(Size::CellIndex(x, y));
+                    else if (gameField[y][x] & Water)
+                        state.water.Set(Size::CellIndex(x, y));
+                }
+            for (int side = 0; side < sideCount; side++)
+            {
+                state.baseAlive |= baseAlive[side] << side;
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    state.tankCell[side][tank] = tankAlive[side][tank] ?
+                        Size::CellIndex(tankX[side][tank], tankY[side][tank]) : -1;
+                }
+            }
+            state.lastShot = LastShots();
+            state.turn = (unsigned char)currentTurn;
+        }
+
+        // 一次算出所有坦克的合法动作掩码，见 TankState::GetLegalActionMasks
+        void GetLegalActionMasks(unsigned short (&masks)[Sides][Tanks], int pruning = PruneNone,
+            typename TankState::ActionSymmetry* symmetry = nullptr) const
+        {
+            TankState state;
+            ExportState(state);
+            state.GetLegalActionMasks(masks, pruning, symmetry);
+        }
+
+        // 从快照恢复局面，之前的回合无法回退
+        // 快照不记录射击方向，上回合射击过的坦克的动作记为 UpShoot
+        void ImportState(const TankState& state)
+        {
+            for (int y = 0; y < fieldHeight; y++)
+                for (int x = 0; x < fieldWidth; x++)
+                {
+                    int cell = Size::CellIndex(x, y);
+                    gameField[y][x] = state.brick.Test(cell) ? Brick :
+                        state.steel.Test(cell) ? Steel :
+                        state.water.Test(cell) ? Water : None;
+                }
+            currentTurn = firstTurn = state.turn;
+            for (int side = 0; side < sideCount; side++)
+            {
+                baseAlive[side] = state.baseAlive >> side & 1;
+                if (baseAlive[side])
+                    gameField[Size::BaseY(side)][Size::BaseX(side)] = Base;
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    int cell = state.tankCell[side][tank];
+                    tankAlive[side][tank] = cell >= 0;
+                    tankX[side][tank] = cell >= 0 ? Size::CellX(cell) : -1;
+                    tankY[side][tank] = cell >= 0 ? Size::CellY(cell) : -1;
+                    if (cell >= 0)
+                        gameField[tankY[side][tank]][tankX[side][tank]] |= Size::TankItem(side, tank);
+                    nextAction[side][tank] = Invalid;
+                }
+            }
+            _restoreLastActions(state.lastShot);
+            logCount = 0;
+            hash = ComputeHash();
+            _syncAllObstacles();
+            _syncLost();
+        }
+
+        // 任意规模的场地：同一格子上 brick > water > steel，坦克和基地在 FieldSize 规定的初始位置
+        BasicTankField(const Bitboard& brick, const Bitboard& water, const Bitboard& steel, int mySide) : mySide(mySide)
+        {
+            for (int y = 0; y < fieldHeight; y++)
+                for (int x = 0; x < fieldWidth; x++)
+                {
+                    int cell = Size::CellIndex(x, y);
+                    if (brick.Test(cell))
+                        gameField[y][x] = Brick;
+                    else if (water.Test(cell))
+                        gameField[y][x] = Water;
+                    else if (steel.Test(cell))
+                        gameField[y][x] = Steel;
+                }
+            for (int side = 0; side < sideCount; side++)
+            {
+                baseAlive[side] = true;
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    tankAlive[side][tank] = true;
+                    tankX[side][tank] = Size::TankStartX(side, tank);
+                    tankY[side][tank] = Size::TankStartY(side, tank);
+                    gameField[tankY[side][tank]][tankX[side][tank]] = Size::TankItem(side, tank);
+                    actionHistory.Set(0, side, tank, Stay);
+                    nextAction[side][tank] = Invalid;
+                }
+                gameField[Size::BaseY(side)][Size::BaseX(side)] = Base;
+            }
+            hash = ComputeHash();
+            _syncAllObstacles();
+            _syncLost();
+        }
+
+        /* 三个 int 表示场地 01 矩阵（每个 int 用 27 位表示 3 行）
+           initialize gameField[][]
+           brick>water>steel
+        */
+        BasicTankField(int hasBrick[3],int hasWater[3],int hasSteel[3], int mySide) :
+            BasicTankField(_decodeField(hasBrick), _decodeField(hasWater), _decodeField(hasSteel), mySide)
+        {
+        }
+        // 打印场地
+        void DebugPrint()
+        {
+#ifndef _BOTZONE_ONLINE
+            const string side2String[] = { "蓝", "红", "绿", "黄" };
+            const string boolean2String[] = { "已炸", "存活" };
+            const char* boldHR = "==============================";
+            const char* slimHR = "------------------------------";
+            cout << boldHR << endl
+                << "图例：" << endl
+                << ". - 空\t# - 砖\t% - 钢\t* - 基地\t@ - 多个坦克" << endl
+                << "b - 蓝0\tB - 蓝1\tr - 红0\tR - 红1\tW - 水" << endl //Tank2 feature
+                << slimHR << endl;
+            for (int y = 0; y < fieldHeight; y++)
+            {
+                for (int x = 0; x < fieldWidth; x++)
+                {
+                    FieldItem items = gameField[y][x];
+                    switch (items)
+                    {
+                    case None:
+                        cout << '.';
+                        break;
+                    case Brick:
+                        cout << '#';
+                        break;
+                    case Steel:
+                        cout << '%';
+                        break;
+                    case Base:
+                        cout << '*';
+                        break;
+                    case Water:
+                        cout << 'W';
+                        break;
+                    default:
+                        if (HasMultipleTank(items))
+                            cout << '@';
+                        else // 绿、黄两方为 g、y，其他编号的坦克与 1 号坦克一样用大写
+                            cout << (char)("brgy"[Size::GetTankSide(items)] - (Size::GetTankID(items) ? 'a' - 'A' : 0));
+                        break;
+                    }
+                }
+                cout << endl;
+            }
+            cout << slimHR << endl;
+            for (int side = 0; side < sideCount; side++)
+            {
+                cout << side2String[side] << "：基地" << boolean2String[baseAlive[side]];
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    cout << ", 坦克" << tank << boolean2String[tankAlive[side][tank]];
+                cout << endl;
+            }
+            cout << "当前回合：" << currentTurn << "，";
+            GameResult result = GetGameResult();
+            if (result == -2)
+                cout << "游戏尚未结束" << endl;
+            else if (result == -1)
+                cout << "游戏平局" << endl;
+            else
+                cout << side2String[result] << "方胜利" << endl;
+            cout << boldHR << endl;
+#endif
+        }
+
+        bool operator!= (const BasicTankField& b) const
+        {
+
+            for (int y = 0; y < fieldHeight; y++)
+                for (int x = 0; x < fieldWidth; x++)
+                    if (gameField[y][x] != b.gameField[y][x])
+                        return true;
+
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    if (tankX[side][tank] != b.tankX[side][tank])
+                        return true;
+                    if (tankY[side][tank] != b.tankY[side][tank])
+                        return true;
+                    if (tankAlive[side][tank] != b.tankAlive[side][tank])
+                        return true;
+                }
+
+            for (int side = 0; side < sideCount; side++)
+                if (baseAlive[side] != b.baseAlive[side])
+                    return true;
+
+            if (currentTurn != b.currentTurn)
+                return true;
+
+            return false;
+        }
+
+    private:
+        // Botzone 的场地编码：第 i 个 int 的第 k 位为第 i * 27 + k 个格子，只适用于 9x9 的场地
+        static Bitboard _decodeField(const int* has)
+        {
+            static_assert(Height == 9 && Width == 9, "the Botzone field encoding is 9x9 only");
+            Bitboard b = {};
+            for (int cell = 0; cell < Size::cellCount; cell++)
+                if (has[cell / 27] >> (cell % 27) & 1)
+                    b.Set(cell);
+            return b;
+        }
+    };
+
+#ifdef _MSC_VER
+#pragma endregion
+
+#pragma region BitTankField 位棋盘实现
+#endif
+
+    // 与 TankField 规则完全一致的另一种场地表示：每种物件一张位棋盘
+    // 移动、射击和合法性判断都化为位运算，供搜索中大量的 DoAction / Revert 使用
+    template<int Height, int Width, int Sides, int Tanks>
+    class BasicBitTankField
+    {
+    public:
+        typedef FieldSize<Height, Width, Sides, Tanks> Size;
+        typedef typename Size::Bitboard Bitboard;
+        typedef BasicTankField<Height, Width, Sides, Tanks> TankField;
+
+        static const int fieldHeight = Height, fieldWidth = Width, sideCount = Sides, tankPerSide = Tanks;
+
+        //!//!//!// 以下变量设计为只读，不推荐进行修改 //!//!//!//
+
+        // 每种物件一张位棋盘，下标见 itemTypeCount 的说明
+        Bitboard board[Size::itemTypeCount] = {};
+
+        // 坦克是否存活
+        bool tankAlive[sideCount][tankPerSide];
+
+        // 基地是否存活
+        bool baseAlive[sideCount];
+
+        // 坦克所在格子的编号，-1表示坦克已炸
+        int tankCell[sideCount][tankPerSide] = {};
+
+        // 当前回合编号
+        int currentTurn = 1;
+
+        // 我是哪一方
+        int mySide;
+
+        // shotMask[x] 表示第 x 回合射击了的坦克（第 side * tankPerSide + tank 位）
+        typename Size::TankMask shotMask[turnCapacity + 1] = {};
+
+        // 基地被炸、坦克全炸的各方（第 side 位），由 DoAction / Revert 维护
+        unsigned baseLost = 0, tanksLost = 0;
+
+        //!//!//!// 以上变量设计为只读，不推荐进行修改 //!//!//!//
+
+        // 本回合双方即将执行的动作，需要手动填入
+        Action nextAction[sideCount][tankPerSide];
+
+        // 所有物件占据的格子
+        Bitboard Occupied() const
+        {
+            Bitboard all = board[0];
+            for (int i = 1; i < Size::itemTypeCount; i++)
+                all |= board[i];
+            return all;
+        }
+
+        // 格子上的物件，与 TankField::gameField[y][x] 相同
+        FieldItem GetItem(int x, int y) const
+        {
+            int cell = Size::CellIndex(x, y), item = 0;
+            for (int i = 0; i < Size::itemTypeCount; i++)
+                item |= (int)board[i].Test(cell) << i;
+            return (FieldItem)item;
+        }
+
+        // 判断行为是否合法（出界或移动到非空格子算作非法）
+        // 未考虑坦克是否存活
+        bool ActionIsValid(int side, int tank, Action act) const
+        {
+            return _actionIsValid(side, tank, act, Occupied());
+        }
+
+        // 判断 nextAction 中的所有行为是否都合法
+        // 忽略掉未存活的坦克
+        bool ActionIsValid() const
+        {
+            Bitboard occupied = Occupied();
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    if (tankAlive[side][tank] && !_actionIsValid(side, tank, nextAction[side][tank], occupied))
+                        return false;
+            return true;
+        }
+
+    private:
+        // 回退用的记录：每回合开始前会变化的物件
+        struct TurnLog
+        {
+            Bitboard brick, base;
+            int tankCell[sideCount][tankPerSide];
+        };
+
+        TurnLog logs[turnCapacity + 1];
+
+        // 能回退到的最早回合
+        int firstTurn = 1;
+
+        static int _tankBoard(int side, int tank)
+        {
+            return Size::TankItemIndex(side, tank);
+        }
+
+        bool _actionIsValid(int side, int tank, Action act, const Bitboard& occupied) const
+        {
+            if (act == Invalid)
+                return false;
+            if (act > Left && (shotMask[currentTurn - 1] >> (side * tankPerSide + tank) & 1)) // 连续两回合射击
+                return false;
+            if (act == Stay || act > Left)
+                return true;
+            int cell = tankCell[side][tank];
+            if (cell < 0)
+                return false;
+            const Bitboard& step = Size::rayTable.step[cell][act];
+            return step.Any() && !(step & occupied).Any();
+        }
+
+        void _setTankCell(int side, int tank, int cell)
+        {
+            Bitboard& b = board[_tankBoard(side, tank)];
+            b = Bitboard();
+            if (cell >= 0)
+                b.Set(cell);
+            tankCell[side][tank] = cell;
+            tankAlive[side][tank] = cell >= 0;
+        }
+
+        // 由位棋盘同步 baseAlive、baseLost 和 tanksLost
+        void _syncLost()
+        {
+            baseLost = tanksLost = 0;
+            for (int side = 0; side < sideCount; side++)
+            {
+                baseAlive[side] = board[2].Test(Size::CellIndex(Size::BaseX(side), Size::BaseY(side)));
+                bool anyTank = false;
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    anyTank |= tankAlive[side][tank];
+                if (!baseAlive[side])
+                    baseLost |= 1u << side;
+                if (!anyTank)
+                    tanksLost |= 1u << side;
+            }
+        }
+
+    public:
+        // 执行 nextAction 中指定的行为并进入下一回合，返回行为是否合法
+        bool DoAction()
+        {
+            if (currentTurn > turnCapacity || !ActionIsValid())
+                return false;
+
+            TurnLog& log = logs[currentTurn];
+            log.brick = board[0];
+            log.base = board[2];
+            memcpy(log.tankCell, tankCell, sizeof(tankCell));
+
+            // 1 移动
+            typename Size::TankMask shots = 0;
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    Action act = nextAction[side][tank];
+                    if (ActionIsShoot(act))
+                        shots |= 1 << (side * tankPerSide + tank);
+                    if (tankAlive[side][tank] && ActionIsMove(act))
+                    {
+                        int to = Size::rayTable.neighbor[tankCell[side][tank]][act];
+                        board[_tankBoard(side, tank)] = Bitboard::Cell(to);
+                        tankCell[side][tank] = to;
+                    }
+                }
+
+            // 2 射击：水不挡子弹，其余物件都会挡住
+            Bitboard hit = Size::ResolveShots(tankCell, nextAction, Occupied() - board[7]);
+
+            // 3 摧毁（钢墙不会被摧毁）
+            board[0] -= hit;
+            board[2] -= hit;
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    if (tankAlive[side][tank] && hit.Test(tankCell[side][tank]))
+                        _setTankCell(side, tank, -1);
+            _syncLost();
+
+            shotMask[currentTurn] = shots;
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    nextAction[side][tank] = Invalid;
+
+            currentTurn++;
+            return true;
+        }
+
+        // 回到上一回合
+        bool Revert()
+        {
+            if (currentTurn == firstTurn)
+                return false;
+
+            currentTurn--;
+            const TurnLog& log = logs[currentTurn];
+            board[0] = log.brick;
+            board[2] = log.base;
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    _setTankCell(side, tank, log.tankCell[side][tank]);
+            _syncLost();
+            return true;
+        }
+
+        // 游戏是否结束？谁赢了？
+        GameResult GetGameResult() const
+        {
+            return Size::JudgeResult(baseLost | tanksLost, currentTurn > maxTurn);
+        }
+
+        // 游戏结束的原因，未结束时为 NotEnded
+        GameEndReason GetEndReason() const
+        {
+            return Size::JudgeEndReason(baseLost, tanksLost, currentTurn > maxTurn);
+        }
+
+        // 从 TankField 的当前局面构造，之前的回合无法回退
+        explicit BasicBitTankField(const TankField& field) : currentTurn(field.currentTurn), mySide(field.mySide), firstTurn(field.currentTurn)
+        {
+            for (int y = 0; y < fieldHeight; y++)
+                for (int x = 0; x < fieldWidth; x++)
+                    for (int i = 0; i < Size::itemTypeCount; i++)
+                        if (field.gameField[y][x] & (1 << i))
+                            board[i].Set(Size::CellIndex(x, y));
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    tankAlive[side][tank] = field.tankAlive[side][tank];
+                    tankCell[side][tank] = field.tankAlive[side][tank] ?
+                        Size::CellIndex(field.tankX[side][tank], field.tankY[side][tank]) : -1;
+                    nextAction[side][tank] = Invalid;
+                }
+            for (int side = 0; side < sideCount; side++)
+                baseAlive[side] = field.baseAlive[side];
+            shotMask[currentTurn - 1] = field.LastShots();
+            baseLost = field.baseLost;
+            tanksLost = field.tanksLost;
+        }
+
+        BasicBitTankField(int hasBrick[3], int hasWater[3], int hasSteel[3], int mySide) :
+            BasicBitTankField(TankField(hasBrick, hasWater, hasSteel, mySide))
+        {
+        }
+
+        // 与 TankField 的局面是否不同（比较方式同 TankField::operator!=）
+        bool operator!= (const TankField& b) const
+        {
+            for (int y = 0; y < fieldHeight; y++)
+                for (int x = 0; x < fieldWidth; x++)
+                    if (GetItem(x, y) != b.gameField[y][x])
+                        return true;
+
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    if (tankAlive[side][tank] != b.tankAlive[side][tank])
+                        return true;
+                    if (tankAlive[side][tank] &&
+                        tankCell[side][tank] != Size::CellIndex(b.tankX[side][tank], b.tankY[side][tank]))
+                        return true;
+                }
+
+            for (int side = 0; side < sideCount; side++)
+                if (baseAlive[side] != b.baseAlive[side])
+                    return true;
+
+            if (currentTurn != b.currentTurn)
+                return true;
+
+            return false;
+        }
+    };
+
+#ifdef _MSC_VER
+#pragma endregion
+
+#pragma region TankBatch 批量模拟
+#endif
+
+    // 多局互相独立的对局，按结构数组（SoA）存放并同步推进，供 rollout 批量使用
+    // 编译时开启 AVX2（如 -mavx2）则每 4 局一组向量化执行，否则逐局使用 TankState::Apply
+    // 两种方式的结果都与 TankField::DoAction 一致
+    template<int Height, int Width, int Sides, int Tanks>
+    class BasicTankBatch
+    {
+    public:
+        typedef FieldSize<Height, Width, Sides, Tanks> Size;
+        typedef BasicTankState<Height, Width, Sides, Tanks> TankState;
+        typedef BasicJointAction<Sides, Tanks> JointAction;
+
+        static const int sideCount = Sides, tankPerSide = Tanks, bitboardWords = Size::bitboardWords;
+
+        explicit BasicTankBatch(int gameCount) : gameCount(gameCount)
+        {
+            for (int w = 0; w < bitboardWords; w++)
+            {
+                brick[w].assign(gameCount, 0);
+                steel[w].assign(gameCount, 0);
+                water[w].assign(gameCount, 0);
+            }
+            for (int i = 0; i < sideCount * tankPerSide; i++)
+                tankCell[i].assign(gameCount, -1);
+            baseAlive.assign(gameCount, 0);
+            lastShot.assign(gameCount, 0);
+            turn.assign(gameCount, 1);
+        }
+
+        int GameCount() const
+        {
+            return gameCount;
+        }
+
+        // 把第 game 局设为 state
+        void Load(int game, const TankState& state)
+        {
+            for (int w = 0; w < bitboardWords; w++)
+            {
+                brick[w][game] = state.brick.word[w];
+                steel[w][game] = state.steel.word[w];
+                water[w][game] = state.water.word[w];
+            }
+            for (int i = 0; i < sideCount * tankPerSide; i++)
+                tankCell[i][game] = state.tankCell[i / tankPerSide][i % tankPerSide];
+            baseAlive[game] = state.baseAlive;
+            lastShot[game] = state.lastShot;
+            turn[game] = state.turn;
+        }
+
+        // 取出第 game 局
+        void Store(int game, TankState& state) const
+        {
+            state = TankState();
+            for (int w = 0; w < bitboardWords; w++)
+            {
+                state.brick.word[w] = brick[w][game];
+                state.steel.word[w] = steel[w][game];
+                state.water.word[w] = water[w][game];
+            }
+            for (int i = 0; i < sideCount * tankPerSide; i++)
+                state.tankCell[i / tankPerSide][i % tankPerSide] = tankCell[i][game];
+            state.baseAlive = (typename Size::TankMask)baseAlive[game];
+            state.lastShot = (typename Size::TankMask)lastShot[game];
+            state.turn = (unsigned char)turn[game];
+        }
+
+        GameResult GetGameResult(int game) const
+        {
+            TankState state;
+            Store(game, state);
+            return state.GetGameResult();
+        }
+
+        // 每局执行 joint[game] 并进入下一回合，valid[game] 返回该局的动作是否合法（不合法的局面不变）
+        void Step(const JointAction* joint, bool* valid)
+        {
+            int game = 0;
+#ifdef __AVX2__
+            for (; game + 4 <= gameCount; game += 4)
+                _step4(game, joint + game, valid + game);
+#endif
+            for (; game < gameCount; game++)
+            {
+                TankState state;
+                Store(game, state);
+                valid[game] = state.Apply(joint[game]);
+                if (valid[game])
+                    Load(game, state);
+            }
+        }
+
+    private:
+        int gameCount;
+        vector<unsigned long long> brick[bitboardWords], steel[bitboardWords], water[bitboardWords];
+        vector<long long> tankCell[sideCount * tankPerSide];
+        vector<long long> baseAlive, lastShot, turn;
+
+#ifdef __AVX2__
+        typedef __m256i Lanes;
+
+        static Lanes _load(const unsigned long long* p) { return _mm256_loadu_si256((const __m256i*)p); }
+        static Lanes _load(const long long* p) { return _mm256_loadu_si256((const __m256i*)p); }
+        static void _store(unsigned long long* p, Lanes v) { _mm256_storeu_si256((__m256i*)p, v); }
+        static void _store(long long* p, Lanes v) { _mm256_storeu_si256((__m256i*)p, v); }
+        static Lanes _set(long long v) { return _mm256_set1_epi64x(v); }
+        static Lanes _and(Lanes a, Lanes b) { return _mm256_and_si256(a, b); }
+        static Lanes _or(Lanes a, Lanes b) { return _mm256_or_si256(a, b); }
+        static Lanes _andNot(Lanes a, Lanes b) { return _mm256_andnot_si256(b, a); } // a & ~b
+        static Lanes _eq(Lanes a, Lanes b) { return _mm256_cmpeq_epi64(a, b); }
+        static Lanes _gt(Lanes a, Lanes b) { return _mm256_cmpgt_epi64(a, b); }
+        static Lanes _nonZero(Lanes a) { return _andNot(_set(-1), _eq(a, _set(0))); }
+        static Lanes _select(Lanes mask, Lanes yes, Lanes no) { return _mm256_blendv_epi8(no, yes, mask); }
+
+        // 格子 cell 在第 w 个字上的位，cell < 0 时为 0
+        static Lanes _cellBit(Lanes cell, int w)
+        {
+            Lanes inWord = _eq(_mm256_srli_epi64(cell, 6), _set(w));
+            return _and(inWord, _mm256_sllv_epi64(_set(1), _and(cell, _set(63))));
         }
 
-        // 游戏是否结束？谁赢了？
-        GameResult GetGameResult()
+        // 位棋盘 board 上格子 cell 是否有物件（全 1 / 全 0 掩码）
+        static Lanes _test(const Lanes (&board)[bitboardWords], Lanes cell)
         {
-            bool fail[sideCount] = {};
-            for (int side = 0; side < sideCount; side++)
-                if ((!tankAlive[side][0] && !tankAlive[side][1]) || !baseAlive[side])
-                    fail[side] = true;
-            if (fail[0] == fail[1])
-                return fail[0] || currentTurn > maxTurn ? Draw : NotFinished;
-            if (fail[Blue])
-                return Red;
-            return Blue;
+            Lanes acc = _set(0);
+            for (int w = 0; w < bitboardWords; w++)
+                acc = _or(acc, _and(board[w], _cellBit(cell, w)));
+            return _nonZero(acc);
         }
 
-        /* 三个 int 表示场地 01 矩阵（每个 int 用 27 位表示 3 行）
-           initialize gameField[][]
-           brick>water>steel
-        */
-        TankField(int hasBrick[3],int hasWater[3],int hasSteel[3], int mySide) : mySide(mySide)
+        // 只保留编号最小 / 最大的一个格子
+        static void _keepLowest(Lanes (&board)[bitboardWords])
         {
-            for (int i = 0; i < 3; i++)
+            Lanes found = _set(0);
+            for (int w = 0; w < bitboardWords; w++)
             {
-                int mask = 1;
-                for (int y = i * 3; y < (i + 1) * 3; y++)
-                {
-                    for (int x = 0; x < fieldWidth; x++)
-                    {
-                        if (hasBrick[i] & mask)
-                            gameField[y][x] = Brick;
-                        else if(hasWater[i] & mask)
-                            gameField[y][x] = Water;
-                        else if(hasSteel[i] & mask)
-                            gameField[y][x] = Steel;
-                        mask <<= 1;
-                    }
-                }
+                Lanes lowest = _and(board[w], _mm256_sub_epi64(_set(0), board[w]));
+                Lanes nonZero = _nonZero(board[w]);
+                board[w] = _andNot(lowest, found);
+                found = _or(found, nonZero);
             }
-            for (int side = 0; side < sideCount; side++)
+        }
+
+        static void _keepHighest(Lanes (&board)[bitboardWords])
+        {
+            Lanes found = _set(0);
+            for (int w = bitboardWords - 1; w >= 0; w--)
             {
-                for (int tank = 0; tank < tankPerSide; tank++)
-                    gameField[tankY[side][tank]][tankX[side][tank]] = tankItemTypes[side][tank];
-                gameField[baseY[side]][baseX[side]] = Base;
+                Lanes smear = board[w];
+                smear = _or(smear, _mm256_srli_epi64(smear, 1));
+                smear = _or(smear, _mm256_srli_epi64(smear, 2));
+                smear = _or(smear, _mm256_srli_epi64(smear, 4));
+                smear = _or(smear, _mm256_srli_epi64(smear, 8));
+                smear = _or(smear, _mm256_srli_epi64(smear, 16));
+                smear = _or(smear, _mm256_srli_epi64(smear, 32));
+                Lanes highest = _andNot(smear, _mm256_srli_epi64(smear, 1));
+                Lanes nonZero = _nonZero(board[w]);
+                board[w] = _andNot(highest, found);
+                found = _or(found, nonZero);
             }
         }
-        // 打印场地
-        void DebugPrint()
+
+        void _step4(int game, const JointAction* joint, bool* valid)
         {
-#ifndef _BOTZONE_ONLINE
-            const string side2String[] = { "蓝", "红" };
-            const string boolean2String[] = { "已炸", "存活" };
-            const char* boldHR = "==============================";
-            const char* slimHR = "------------------------------";
-            cout << boldHR << endl
-                << "图例：" << endl
-                << ". - 空\t# - 砖\t% - 钢\t* - 基地\t@ - 多个坦克" << endl
-                << "b - 蓝0\tB - 蓝1\tr - 红0\tR - 红1\tW - 水" << endl //Tank2 feature
-                << slimHR << endl;
-            for (int y = 0; y < fieldHeight; y++)
+            const int tankCount = sideCount * tankPerSide;
+            Lanes act[tankCount], cell[tankCount], alive[tankCount];
+            for (int i = 0; i < tankCount; i++)
             {
-                for (int x = 0; x < fieldWidth; x++)
-                {
-                    switch (gameField[y][x])
-                    {
-                    case None:
-                        cout << '.';
-                        break;
-                    case Brick:
-                        cout << '#';
-                        break;
-                    case Steel:
-                        cout << '%';
-                        break;
-                    case Base:
-                        cout << '*';
-                        break;
-                    case Blue0:
-                        cout << 'b';
-                        break;
-                    case Blue1:
-                        cout << 'B';
-                        break;
-                    case Red0:
-                        cout << 'r';
-                        break;
-                    case Red1:
-                        cout << 'R';
-                        break;
-                    case Water:
-                        cout << 'W';
-                        break;
-                    default:
-                        cout << '@';
-                        break;
-                    }
-                }
-                cout << endl;
+                int side = i / tankPerSide, tank = i % tankPerSide;
+                act[i] = _mm256_set_epi64x(joint[3].act[side][tank], joint[2].act[side][tank],
+                    joint[1].act[side][tank], joint[0].act[side][tank]);
+                cell[i] = _load(&tankCell[i][game]);
+                alive[i] = _gt(cell[i], _set(-1));
             }
-            cout << slimHR << endl;
+            Lanes bases = _load(&baseAlive[game]), shot = _load(&lastShot[game]), turns = _load(&turn[game]);
+            Lanes bricks[bitboardWords], steels[bitboardWords], waters[bitboardWords], occupied[bitboardWords];
+            Lanes baseCell[sideCount], baseLive[sideCount];
             for (int side = 0; side < sideCount; side++)
             {
-                cout << side2String[side] << "：基地" << boolean2String[baseAlive[side]];
-                for (int tank = 0; tank < tankPerSide; tank++)
-                    cout << ", 坦克" << tank << boolean2String[tankAlive[side][tank]];
-                cout << endl;
+                baseCell[side] = _set(Size::CellIndex(Size::BaseX(side), Size::BaseY(side)));
+                baseLive[side] = _nonZero(_and(bases, _set(1LL << side)));
+            }
+            for (int w = 0; w < bitboardWords; w++)
+            {
+                bricks[w] = _load(&brick[w][game]);
+                steels[w] = _load(&steel[w][game]);
+                waters[w] = _load(&water[w][game]);
+                occupied[w] = _or(bricks[w], _or(steels[w], waters[w]));
+                for (int side = 0; side < sideCount; side++)
+                    occupied[w] = _or(occupied[w], _and(baseLive[side], _cellBit(baseCell[side], w)));
+                for (int i = 0; i < tankCount; i++)
+                    occupied[w] = _or(occupied[w], _cellBit(cell[i], w));
             }
-            cout << "当前回合：" << currentTurn << "，";
-            GameResult result = GetGameResult();
-            if (result == -2)
-                cout << "游戏尚未结束" << endl;
-            else if (result == -1)
-                cout << "游戏平局" << endl;
-            else
-                cout << side2String[result] << "方胜利" << endl;
-            cout << boldHR << endl;
-#endif
-        }
-
-        bool operator!= (const TankField& b) const
-        {
 
-            for (int y = 0; y < fieldHeight; y++)
-                for (int x = 0; x < fieldWidth; x++)
-                    if (gameField[y][x] != b.gameField[y][x])
-                        return true;
+            // 合法性判断，同时算出移动后的位置
+            Lanes ok = _gt(_set(turnCapacity + 1), turns), shots = _set(0), moved[tankCount];
+            for (int i = 0; i < tankCount; i++)
+            {
+                Lanes isShoot = _gt(act[i], _set(Left)), isMove = _andNot(_gt(act[i], _set(Stay)), isShoot);
+                shots = _or(shots, _and(isShoot, _set(1LL << i)));
+                Lanes doubleShot = _and(isShoot, _nonZero(_and(shot, _set(1LL << i))));
+                Lanes movable = _and(alive[i], isMove);
+                Lanes bad = _or(_eq(act[i], _set(Invalid)), doubleShot);
+                moved[i] = cell[i];
+                if (!_mm256_testz_si256(movable, movable))
+                {
+                    Lanes index = _and(movable, _mm256_add_epi64(_mm256_slli_epi64(cell[i], 2), act[i]));
+                    Lanes target = _mm256_cvtepi32_epi64(_mm256_i64gather_epi32(&Size::rayTable.neighbor[0][0], index, 4));
+                    Lanes blocked = _or(_gt(_set(0), target), _test(occupied, target));
+                    bad = _or(bad, _and(isMove, blocked));
+                    moved[i] = _select(movable, target, cell[i]);
+                }
+                ok = _andNot(ok, _and(alive[i], bad));
+            }
 
-            for (int side = 0; side < sideCount; side++)
-                for (int tank = 0; tank < tankPerSide; tank++)
+            // 射击：水不挡子弹
+            Lanes obstacles[bitboardWords], hit[bitboardWords], movedBit[tankCount][bitboardWords];
+            for (int w = 0; w < bitboardWords; w++)
+            {
+                obstacles[w] = _or(bricks[w], steels[w]);
+                for (int side = 0; side < sideCount; side++)
+                    obstacles[w] = _or(obstacles[w], _and(baseLive[side], _cellBit(baseCell[side], w)));
+                for (int i = 0; i < tankCount; i++)
                 {
-                    if (tankX[side][tank] != b.tankX[side][tank])
-                        return true;
-                    if (tankY[side][tank] != b.tankY[side][tank])
-                        return true;
-                    if (tankAlive[side][tank] != b.tankAlive[side][tank])
-                        return true;
+                    movedBit[i][w] = _cellBit(moved[i], w);
+                    obstacles[w] = _or(obstacles[w], movedBit[i][w]);
+                }
+                hit[w] = _set(0);
+            }
+            for (int i = 0; i < tankCount; i++)
+            {
+                Lanes firing = _and(alive[i], _gt(act[i], _set(Left)));
+                if (_mm256_testz_si256(firing, firing))
+                    continue;
+                Lanes dir = _and(act[i], _set(3));
+                Lanes rayIndex = _and(firing, _mm256_add_epi64(_mm256_slli_epi64(moved[i], 2), dir));
+                Lanes target[bitboardWords];
+                for (int w = 0; w < bitboardWords; w++)
+                {
+                    Lanes index = _mm256_add_epi64(_mm256_mul_epu32(rayIndex, _set(bitboardWords)), _set(w));
+                    Lanes ray = _mm256_i64gather_epi64((const long long*)&Size::rayTable.ray[0][0].word[0], index, 8);
+                    target[w] = _and(firing, _and(ray, obstacles[w]));
                 }
 
-            if (baseAlive[0] != b.baseAlive[0] ||
-                baseAlive[1] != b.baseAlive[1])
-                return true;
+                // 右、下取最低位，上、左取最高位
+                Lanes ascending = _or(_eq(dir, _set(Right)), _eq(dir, _set(Down)));
+                Lanes low[bitboardWords], high[bitboardWords];
+                for (int w = 0; w < bitboardWords; w++)
+                    low[w] = high[w] = target[w];
+                _keepLowest(low);
+                _keepHighest(high);
+                for (int w = 0; w < bitboardWords; w++)
+                    target[w] = _select(ascending, low[w], high[w]);
 
-            if (currentTurn != b.currentTurn)
-                return true;
+                // 对射判断：自己这里和射到的目标格子都只有一个坦克，而且射击方向相反，那么就忽视这次射击
+                Lanes myCount = _set(0), targetCount = _set(0), opposite = _set(0);
+                for (int j = 0; j < tankCount; j++)
+                {
+                    Lanes overlap = _set(0);
+                    for (int w = 0; w < bitboardWords; w++)
+                        overlap = _or(overlap, _and(target[w], movedBit[j][w]));
+                    Lanes here = _and(alive[j], _eq(moved[j], moved[i]));
+                    Lanes there = _and(alive[j], _nonZero(overlap));
+                    myCount = _mm256_sub_epi64(myCount, here);
+                    targetCount = _mm256_sub_epi64(targetCount, there);
+                    Lanes theirShoot = _gt(act[j], _set(Left));
+                    Lanes theirDir = _and(act[j], _set(3));
+                    opposite = _or(opposite, _and(there, _and(theirShoot, _eq(theirDir, _mm256_xor_si256(dir, _set(2))))));
+                }
+                Lanes ignored = _and(_and(_eq(myCount, _set(1)), _eq(targetCount, _set(1))), opposite);
+                for (int w = 0; w < bitboardWords; w++)
+                    hit[w] = _or(hit[w], _andNot(target[w], ignored));
+            }
 
-            return false;
+            // 摧毁（钢墙不会被摧毁），只写回合法的局
+            for (int w = 0; w < bitboardWords; w++)
+                _store(&brick[w][game], _select(ok, _andNot(bricks[w], hit[w]), bricks[w]));
+            Lanes newBases = bases;
+            for (int side = 0; side < sideCount; side++)
+                newBases = _andNot(newBases, _and(_test(hit, baseCell[side]), _set(1LL << side)));
+            _store(&baseAlive[game], _select(ok, newBases, bases));
+            for (int i = 0; i < tankCount; i++)
+            {
+                Lanes destroyed = _and(alive[i], _test(hit, moved[i]));
+                _store(&tankCell[i][game], _select(ok, _select(destroyed, _set(-1), moved[i]), cell[i]));
+            }
+            _store(&lastShot[game], _select(ok, shots, shot));
+            _store(&turn[game], _select(ok, _mm256_add_epi64(turns, _set(1)), turns));
+
+            int okBits = _mm256_movemask_pd(_mm256_castsi256_pd(ok));
+            for (int k = 0; k < 4; k++)
+                valid[k] = okBits >> k & 1;
         }
+#endif
     };
 
 #ifdef _MSC_VER
 #pragma endregion
 #endif
 
-    TankField *field;
+#ifdef _MSC_VER
+#pragma region 默认规模
+#endif
+
+    // Botzone 上的规模：9x9 的场地，两方各 2 个坦克
+    // 以下名字只用于默认规模，放在所有模板之后，模板内部误用它们会编译失败
+    typedef FieldSize<9, 9, 2, 2> DefaultFieldSize;
+
+    const int fieldHeight = DefaultFieldSize::fieldHeight, fieldWidth = DefaultFieldSize::fieldWidth,
+        sideCount = DefaultFieldSize::sideCount, tankPerSide = DefaultFieldSize::tankPerSide;
+
+    const int cellCount = DefaultFieldSize::cellCount;
+
+    // 基地的横坐标
+    const int baseX[sideCount] = { DefaultFieldSize::BaseX(Blue), DefaultFieldSize::BaseX(Red) };
+
+    // 基地的纵坐标
+    const int baseY[sideCount] = { DefaultFieldSize::BaseY(Blue), DefaultFieldSize::BaseY(Red) };
+
+    typedef DefaultFieldSize::Bitboard Bitboard;
+    typedef BasicJointAction<sideCount, tankPerSide> JointAction;
+    typedef BasicJointActionIterator<sideCount, tankPerSide> JointActionIterator;
+    typedef BasicActionSymmetry<sideCount, tankPerSide> ActionSymmetry;
+    typedef BasicTankState<fieldHeight, fieldWidth, sideCount, tankPerSide> TankState;
+    typedef BasicTankField<fieldHeight, fieldWidth, sideCount, tankPerSide> TankField;
+    typedef BasicBitTankField<fieldHeight, fieldWidth, sideCount, tankPerSide> BitTankField;
+    typedef BasicTankBatch<fieldHeight, fieldWidth, sideCount, tankPerSide> TankBatch;
+    typedef BasicThreatMap<DefaultFieldSize> ThreatMap;
+    typedef BasicDistanceTable<DefaultFieldSize> DistanceTable;
+    typedef BasicPathSearch<DefaultFieldSize> PathSearch;
+    typedef BasicFlowField<DefaultFieldSize> FlowField;
+    typedef BasicReservationTable<DefaultFieldSize> ReservationTable;
+    typedef BasicActionPlanner<DefaultFieldSize> ActionPlanner;
+
+    static_assert(sizeof(TankState) < 64, "TankState should fit in one cache line");
+    static_assert(std::is_trivially_copyable<TankState>::value, "TankState should be trivially copyable");
+
+    constexpr const DefaultFieldSize::RayTable& rayTable = DefaultFieldSize::rayTable;
+
+    constexpr bool CoordValid(int x, int y)
+    {
+        return DefaultFieldSize::CoordValid(x, y);
+    }
+
+    constexpr int CellIndex(int x, int y)
+    {
+        return DefaultFieldSize::CellIndex(x, y);
+    }
+
+    constexpr int CellX(int cell)
+    {
+        return DefaultFieldSize::CellX(cell);
+    }
+
+    constexpr int CellY(int cell)
+    {
+        return DefaultFieldSize::CellY(cell);
+    }
+
+    inline int FirstObstacle(int cell, int dir, const Bitboard& obstacles)
+    {
+        return DefaultFieldSize::FirstObstacle(cell, dir, obstacles);
+    }
+
+#ifdef _MSC_VER
+#pragma endregion
+#endif
 
 #ifdef _MSC_VER
 #pragma region 与平台交互部分
 #endif
 
-    // 内部函数
-    namespace Internals
+    // 一局游戏在平台交互层的全部状态，以下函数都通过它读写场地和输出
+    // 每局一个，互不共享，不同的对局可以放在不同线程里同时进行
+    struct GameContext
     {
+        // 第一回合读入场地后才创建，由 GameContext 释放；每次读到场地都会换成新的，不要长期保存这个指针
+        TankField* field = nullptr;
+
+        // 读到场地的次数，每次 field 换成新的场地时加一
+        int fieldCount = 0;
+
+        // 决策输出到这里
+        std::ostream* out = &cout;
+
         Json::Reader reader;
 #ifdef _BOTZONE_ONLINE
         Json::FastWriter writer;
@@ -605,8 +3626,22 @@ namespace TankGame
         Json::StyledWriter writer;
 #endif
 
-        void _processRequestOrResponse(Json::Value& value, bool isOpponent)
+        GameContext() = default;
+        GameContext(const GameContext&) = delete;
+        GameContext& operator= (const GameContext&) = delete;
+
+        ~GameContext()
         {
+            delete field;
+        }
+    };
+
+    // 内部函数
+    namespace Internals
+    {
+        void _processRequestOrResponse(GameContext& game, Json::Value& value, bool isOpponent)
+        {
+            TankField* field = game.field;
             if (value.isArray())
             {
                 if (!isOpponent)
@@ -630,12 +3665,14 @@ namespace TankGame
                     hasBrick[i] = value["brickfield"][i].asInt();
                     hasSteel[i] = value["steelfield"][i].asInt();
                 }
-                field = new TankField(hasBrick,hasWater,hasSteel,value["mySide"].asInt());
+                delete game.field;
+                game.field = new TankField(hasBrick,hasWater,hasSteel,value["mySide"].asInt());
+                game.fieldCount++;
             }
         }
 
         // 请使用 SubmitAndExit 或者 SubmitAndDontExit
-        void _submitAction(Action tank0, Action tank1, string debug = "", string data = "", string globalData = "")
+        void _submitAction(GameContext& game, Action tank0, Action tank1, string debug = "", string data = "", string globalData = "")
         {
             Json::Value output(Json::objectValue), response(Json::arrayValue);
             response[0U] = tank0;
@@ -647,13 +3684,13 @@ namespace TankGame
                 output["data"] = data;
             if (!globalData.empty())
                 output["globalData"] = globalData;
-            cout << writer.write(output) << endl;
+            *game.out << game.writer.write(output) << endl;
         }
     }
 
-    // 从输入流（例如 cin 或者 fstream）读取回合信息，存入 TankField，并提取上回合存储的 data 和 globaldata
+    // 从输入流（例如 cin 或者 fstream）读取回合信息，存入 game.field，并提取上回合存储的 data 和 globaldata
     // 本地调试的时候支持多行，但是最后一行需要以没有缩进的一个"}"或"]"结尾
-    void ReadInput(istream& in, string& outData, string& outGlobalData)
+    void ReadInput(GameContext& game, istream& in, string& outData, string& outGlobalData)
     {
         Json::Value input;
         string inputString;
@@ -675,7 +3712,7 @@ namespace TankGame
             } while (newString != "}" && newString != "]");
         }
 #endif
-        Internals::reader.parse(inputString, input);
+        game.reader.parse(inputString, input);
 
         if (input.isObject())
         {
@@ -686,18 +3723,18 @@ namespace TankGame
                 int i;
                 for (i = 0; i < n; i++)
                 {
-                    Internals::_processRequestOrResponse(requests[i], true);
+                    Internals::_processRequestOrResponse(game, requests[i], true);
                     if (i < n - 1)
-                        Internals::_processRequestOrResponse(responses[i], false);
+                        Internals::_processRequestOrResponse(game, responses[i], false);
                 }
                 outData = input["data"].asString();
                 outGlobalData = input["globaldata"].asString();
                 return;
             }
         }
-        Internals::_processRequestOrResponse(input, true);
+        Internals::_processRequestOrResponse(game, input, true);
     }
-    void ReadInput_longlive(istream& in)
+    void ReadInput_longlive(GameContext& game, istream& in)
     {
         Json::Value input;
         string inputString;
@@ -719,7 +3756,7 @@ namespace TankGame
             } while (newString != "}" && newString != "]");
         }
 #endif
-        Internals::reader.parse(inputString, input);
+        game.reader.parse(inputString, input);
 #ifdef DEBUG
                 cout<<"LongLive"<<endl;
                 #endif
@@ -735,28 +3772,28 @@ namespace TankGame
                 int i;
                 for (i = 0; i < n; i++)
                 {
-                    Internals::_processRequestOrResponse(requests[i], true);
+                    Internals::_processRequestOrResponse(game, requests[i], true);
                 }
                 return;
         }
-        Internals::_processRequestOrResponse(input, true);
+        Internals::_processRequestOrResponse(game, input, true);
     }
 
     // 提交决策并退出，下回合时会重新运行程序
-    void SubmitAndExit(Action tank0, Action tank1, string debug = "", string data = "", string globalData = "")
+    void SubmitAndExit(GameContext& game, Action tank0, Action tank1, string debug = "", string data = "", string globalData = "")
     {
-        Internals::_submitAction(tank0, tank1, debug, data, globalData);
+        Internals::_submitAction(game, tank0, tank1, debug, data, globalData);
         exit(0);
     }
 
     // 提交决策，下回合时程序继续运行（需要在 Botzone 上提交 Bot 时选择“允许长时运行”）
     // 如果游戏结束，程序会被系统杀死
-    void SubmitAndDontExit(Action tank0, Action tank1)
+    void SubmitAndDontExit(GameContext& game, Action tank0, Action tank1)
     {
-        Internals::_submitAction(tank0, tank1);
-        field->nextAction[field->mySide][0] = tank0;
-        field->nextAction[field->mySide][1] = tank1;
-        cout << ">>>BOTZONE_REQUEST_KEEP_RUNNING<<<" << endl;
+        Internals::_submitAction(game, tank0, tank1);
+        game.field->nextAction[game.field->mySide][0] = tank0;
+        game.field->nextAction[game.field->mySide][1] = tank1;
+        *game.out << ">>>BOTZONE_REQUEST_KEEP_RUNNING<<<" << endl;
     }
 #ifdef _MSC_VER
 #pragma endregion
@@ -767,18 +3804,28 @@ namespace TankGame
 namespace TankGame{
 
 /*RandAction*/
-int RandBetween(int from, int to)
+// Random numbers come from the caller's generator (one per agent), never
+// the process-wide rand(): games on other threads must not share it.
+int RandBetween(std::mt19937& rng, int from, int to)
 {
-    return rand() % (to - from) + from;
+    return std::uniform_int_distribution<int>(from, to - 1)(rng);
 }
-Action RandAction(int tank)
+template<typename Field>
+Action RandAction(const Field& field, int tank, std::mt19937& rng)
 {
-    while (true)
-    {
-        auto act = (TankGame::Action)RandBetween(TankGame::Stay, TankGame::LeftShoot + 1);
-        if (TankGame::field->ActionIsValid(TankGame::field->mySide, tank, act))
-            return act;
-    }
+    unsigned short masks[Field::sideCount][Field::tankPerSide];
+    field.GetLegalActionMasks(masks);
+    unsigned short mask = masks[field.mySide][tank];
+
+    // 在合法动作中均匀地选一个
+    int pick = 0;
+    for (int act = TankGame::Stay; act <= TankGame::LeftShoot; act++)
+        pick += !!(mask & ActionBit((Action)act));
+    pick = RandBetween(rng, 0, pick);
+    for (int act = TankGame::Stay; act <= TankGame::LeftShoot; act++)
+        if ((mask & ActionBit((Action)act)) && pick-- == 0)
+            return (Action)act;
+    return TankGame::Stay;
 }
 
 
@@ -789,15 +3836,27 @@ enum AgentState{
     DEFEND = 3
 };
 
-#define TANK_CNT 2
 #define INF 0x7fffffff
 #include<set>
 
-  class HeadQuarter{
+  // Enemy tanks are numbered side * Tanks + tank over every other side.
+  template<int Height, int Width, int Sides, int Tanks>
+  class BasicHeadQuarter{
     public:
-      AgentState cur_state[TANK_CNT];
+      typedef FieldSize<Height, Width, Sides, Tanks> Size;
+      typedef BasicTankField<Height, Width, Sides, Tanks> TankField;
+      typedef BasicThreatMap<Size> ThreatMap;
+      typedef BasicFlowField<Size> FlowField;
+      typedef BasicReservationTable<Size> ReservationTable;
+      typedef BasicActionPlanner<Size> ActionPlanner;
+      static const int fieldHeight = Height, fieldWidth = Width, sideCount = Sides, tankPerSide = Tanks;
+
+      TankField* field;
+      AgentState cur_state[tankPerSide];
       int mySide;
-      bool has_shoot[2];
+      // This agent's own random numbers; seed it per game (the default
+      // seed is fixed, which keeps replays reproducible).
+      std::mt19937 rng;
       
       // Take action
       Action takeAction(int tank_id);
@@ -807,33 +3866,55 @@ enum AgentState{
 
       // EXPLORE
       Action Explore(int tank_id);
-      // for A* algorithm, f = g(real) + h(estimate)
-      bool first_move[2];
-      void A_search(int tank_id,int dst_x, int dst_y);
-      int getEstimateScore(int x,int y,int dst_x,int dst_y);
-      int g_score[2][fieldHeight][fieldWidth];
-      int h_score[2][fieldHeight][fieldWidth]; 
-      int pfather[2][fieldHeight][fieldWidth];
-      deque<int> next_loc_x[2];
-      deque<int> next_loc_y[2];
+
+      // The terrain the routes below run on, read from the field once per
+      // turn by syncTerrain(): bricks, cells no tank can enter (steel,
+      // water), and the turns to enter each cell (0 if it cannot be
+      // entered, 2 for a brick or a base: shoot, then move; else 1).
+      typename Size::Bitboard brick, blocked;
+      unsigned char enter_cost[Size::cellCount];
+      void syncTerrain();
+
+      // Where every tank's shot would land this turn, and the enemy firing
+      // lines now and after their next move, computed once per turn; every
+      // route below pays its penalty for entering them.
+      typename TankField::AttackMap attacks;
+      ThreatMap threats;
+
+      // Distance fields towards the enemy base (Explore) and ours (Defend),
+      // shared by both tanks. Computed on the first turn, then repaired
+      // once per turn for the cells whose cost changed.
+      FlowField to_enemy_base, to_our_base;
+      int flow_turn;
+      void updateFlowFields();
+      // One step along flow: shoot the next cell if it holds one of
+      // shoot_at, move if it is empty, otherwise wait.
+      Action followFlow(int tank_id,const FlowField& flow,FieldItem shoot_at);
+      // Turn-exact plans to hit the enemy base that respect the shot
+      // cooldown, made once per turn for both tanks together: each tank
+      // reserves its cells and shots for the next few turns and the later
+      // ones route around them, so our tanks neither block nor stack.
+      ActionPlanner planner;
+      ReservationTable reserved;
+      Action route_step[tankPerSide];
+      int route_cost[tankPerSide];
+      int route_turn;
+      void planRoutes();
 
       // Attack
       Action Attack(int tank_id);
       Action inShootRange(int tank_id,int e_tank_id);
       // aim[i] marks the idx of the enemy tank that 
       // tank i of our side aims at
-      vector<int> aim[2];
+      vector<int> aim[tankPerSide];
 
       // Defend
       Action Defend(int tank_id);
 
-      HeadQuarter(){
-          cur_state[0] = EXPLORE;
-          cur_state[1] = EXPLORE;
-          first_move[0] = true;
-          first_move[1] = true;
-          has_shoot[0] = false;
-          has_shoot[1] = false;
+      BasicHeadQuarter() : field(nullptr), flow_turn(-1), route_turn(-1){
+          for(int i = 0; i < tankPerSide; ++i){
+              cur_state[i] = EXPLORE;
+          }
         }
     private:
         int getManhattenDist(int x,int y, int dst_x,int dst_y){
@@ -841,36 +3922,60 @@ enum AgentState{
             int dy = abs(dst_y-y);
             return dx+dy;
         }
+        // Whether another alive tank (of either side) is on our tank's cell.
+        bool cellShared(int tank_id){
+            for(int side = 0; side < sideCount; ++side)
+                for(int tank = 0; tank < tankPerSide; ++tank)
+                    if(field->tankAlive[side][tank] && (side != mySide || tank != tank_id) &&
+                       field->tankX[side][tank] == field->tankX[mySide][tank_id] &&
+                       field->tankY[side][tank] == field->tankY[mySide][tank_id])
+                        return true;
+            return false;
+        }
+        // The enemy tank closest to (x,y); ties go to the later one.
+        int closestEnemy(int x,int y,int& dist){
+            int best = -1;
+            for(int e = 0; e < sideCount*tankPerSide; ++e){
+                if(e/tankPerSide == mySide)
+                    continue;
+                int d = getManhattenDist(x,y,field->tankX[e/tankPerSide][e%tankPerSide],
+                                             field->tankY[e/tankPerSide][e%tankPerSide]);
+                if(best<0 || d<=dist){
+                    best = e;
+                    dist = d;
+                }
+            }
+            return best;
+        }
   };
 
-  bool HeadQuarter::changeState(int tank_id){
-    int dist1,dist2;
+  template<int Height, int Width, int Sides, int Tanks>
+  bool BasicHeadQuarter<Height, Width, Sides, Tanks>::changeState(int tank_id){
+    int dist = INF;
     int i= tank_id;
     // change to attack: if enemy tank is close
-    dist1 = getManhattenDist(field->tankX[mySide][i],field->tankY[mySide][i],
-                                field->tankX[(mySide+1)%2][0],field->tankY[(mySide+1)%2][0]);
-    dist2 = getManhattenDist(field->tankX[mySide][i],field->tankY[mySide][i],
-                                field->tankX[(mySide+1)%2][1],field->tankY[(mySide+1)%2][1]);
-    if(dist2<=2 || dist1<=2){
-        aim[i].push_back( ((dist1<dist2)?0:1));
+    int e = closestEnemy(field->tankX[mySide][i],field->tankY[mySide][i],dist);
+    // or if an enemy tank can already hit us next turn
+    int threat = -1;
+    if(field->tankAlive[mySide][i])
+        threat = attacks.ThreatTo(Size::CellIndex(field->tankX[mySide][i],field->tankY[mySide][i]),mySide);
+    if(dist<=2 || threat>=0){
+        aim[i].push_back(dist<=2 ? e : threat);
         cur_state[i] = ATTACK;
         return true;
     }
 
     // defend: if enemy tank is close to our base
-    dist1 = getManhattenDist(baseX[mySide],baseY[mySide],
-                                field->tankX[(mySide+1)%2][0],field->tankY[(mySide+1)%2][0]);
-    dist2 = getManhattenDist(baseX[mySide],baseY[mySide],
-                                field->tankX[(mySide+1)%2][1],field->tankY[(mySide+1)%2][1]);
-    if(dist2<=2 || dist1<=2){
-        aim[i].push_back( ((dist1<dist2)?0:1));
+    e = closestEnemy(Size::BaseX(mySide),Size::BaseY(mySide),dist);
+    if(dist<=2){
+        aim[i].push_back(e);
         cur_state[i] = DEFEND;
         return true;
     }
-    
+
     // back to explore: if enemy tank is destroyed
     if((cur_state[i] == DEFEND || cur_state[i]==ATTACK)
-    && field->tankX[(mySide+1)%2][aim[i][0]]==-1){
+    && field->tankX[aim[i][0]/tankPerSide][aim[i][0]%tankPerSide]==-1){
         cur_state[i] = EXPLORE;
         aim[i].erase(aim[i].begin());
     }
@@ -878,14 +3983,20 @@ enum AgentState{
   }
 
 
-  Action HeadQuarter::takeAction(int tank_id){
+  template<int Height, int Width, int Sides, int Tanks>
+  Action BasicHeadQuarter<Height, Width, Sides, Tanks>::takeAction(int tank_id){
       #ifdef DEBUG
         cout<<"cur state of "<<tank_id<<" is "<<cur_state[tank_id]<<endl;
       #endif
 
+    // Whether we shot last turn comes from the field, not from memory of
+    // our own answers: they disagree e.g. right after ReadInput replays
+    // the history, or when another program played the earlier turns.
+    bool shot = ActionIsShoot(field->PreviousAction(field->currentTurn-1,mySide,tank_id));
     #ifdef DEBUG
-        cout<<"Shot state of "<<tank_id<<" is "<<has_shoot[tank_id]<<endl;
+        cout<<"Shot state of "<<tank_id<<" is "<<shot<<endl;
       #endif
+    updateFlowFields();
     changeState(tank_id);
     if(!field->tankAlive[mySide][tank_id])
       return Stay;
@@ -907,215 +4018,192 @@ enum AgentState{
     }
 
     // Shooting twice is prohibited.
-    if( !ActionIsShoot(to_take) ){
-        has_shoot[tank_id] = false;
-    }else{
-        if(has_shoot[tank_id]){
-            to_take = Stay;
-            has_shoot[tank_id] = false;
-        }else{
-            has_shoot[tank_id] = true;
-        }
-    }
-    #ifdef DEBUG
-        cout<<"Shot state of "<<tank_id<<" is "<<has_shoot[tank_id]<<endl;
-      #endif
+    if(shot && ActionIsShoot(to_take))
+        to_take = Stay;
     return to_take;
   }
 
-  int HeadQuarter::getEstimateScore(int x,int y,int dst_x,int dst_y){
-    /* Can be further modified:
-     TODO: come up with better strategy for path searching by modifying
-     the estimation function here. 
-    */
-
-      return getManhattenDist(x,y,dst_x,dst_y);
+  template<int Height, int Width, int Sides, int Tanks>
+  void BasicHeadQuarter<Height, Width, Sides, Tanks>::syncTerrain(){
+    brick = blocked = typename Size::Bitboard();
+    for(int cell = 0; cell < Size::cellCount; ++cell){
+        FieldItem items = field->gameField[Size::CellY(cell)][Size::CellX(cell)];
+        if(items & Brick)
+            brick.Set(cell);
+        if(items & (Steel | Water))
+            blocked.Set(cell);
+        // Same rules as DistanceTable: a base cell costs 2 even once the
+        // base is gone.
+        bool base = false;
+        for(int side = 0; side < sideCount; ++side)
+            base |= cell == Size::CellIndex(Size::BaseX(side),Size::BaseY(side));
+        enter_cost[cell] = blocked.Test(cell) ? 0 : brick.Test(cell) || base ? 2 : 1;
+    }
   }
 
 
-  void HeadQuarter::A_search(int tank_id,int dst_x,int dst_y){
-    /*
-    Implementation of A * search algorithm. Faster than BFS and can be adaptive.
-    Let starting point be S, destinnation point be D
-    for each nodes i in a graph G:
-        f[i] = g[i] + h[i]
-        g[i]: the REAL cost of getting to i from S
-            can be calculated easily. g[i] = g[i-1] + cost(from i-1 to i)
-        h[i]: the ESTIMATED cost of getting to D from i
-            need sophisticated guess or estimate.
-    the select path is stored in next_loc_{xy}
-    */
-    mySide = field->mySide;
-    int x0 = field->tankX[mySide][tank_id];
-    int y0 = field->tankY[mySide][tank_id];
-    set< pair<int, int > > open_list, close_list;
-    open_list.insert(make_pair(x0,y0));
-    g_score[tank_id][y0][x0] = 0;
-    h_score[tank_id][y0][x0] = getEstimateScore(x0,y0,dst_x,dst_y);
-    pfather[tank_id][y0][x0] = -1;
-
-
-    bool success = false;
-    while(true){
-
-        auto min_loc = open_list.begin();
-        int min_f = INF;
-        for(auto it = open_list.begin(); it!= open_list.end();++it){
-            int x = it->first,y = it->second;
-            if(g_score[tank_id][y][x] + h_score[tank_id][y][x] < min_f){
-                min_loc = it;
-                min_f = g_score[tank_id][y][x] + h_score[tank_id][y][x];
-            }
-        }
-        close_list.insert(*min_loc);
-        open_list.erase(*min_loc);
-        int x = min_loc->first,y = min_loc->second;
-
-
-        for(int i = 0 ;i < 4; ++i){
-            int _x = x+dx[i];
-            int _y = y+dy[i];
-            if(_x<0 || _y <0 || _x>=fieldWidth || _y>=fieldHeight)
-                continue;
-            
-            if(close_list.find(make_pair(_x,_y))!=close_list.end()||
-                ( field->gameField[_y][_x]& (Steel | Water )) != 0 ||
-                (_y==baseY[mySide] && _x == baseX[mySide])){//in close list or can't reach
+  template<int Height, int Width, int Sides, int Tanks>
+  void BasicHeadQuarter<Height, Width, Sides, Tanks>::updateFlowFields(){
+    if(flow_turn == field->currentTurn)
+        return;
+    flow_turn = field->currentTurn;
+    syncTerrain();
+    int tank_cell[sideCount][tankPerSide];
+    for(int side = 0; side < sideCount; ++side)
+        for(int tank = 0; tank < tankPerSide; ++tank)
+            tank_cell[side][tank] = field->tankAlive[side][tank] ?
+                Size::CellIndex(field->tankX[side][tank],field->tankY[side][tank]) : -1;
+    field->GetAttackMap(attacks);
+    threats.Compute(attacks,tank_cell,mySide,field->obstacles,blocked);
 
-                continue;
-                }
-            if(open_list.find(make_pair(_x,_y))==open_list.end()){
-
-                open_list.insert(make_pair(_x,_y));
-                
-                pfather[tank_id][_y][_x] = (i+2)%4;
-                h_score[tank_id][_y][_x] = getEstimateScore(_x,_y,dst_x,dst_y);
-                g_score[tank_id][_y][_x] = ((field->gameField[_y][_x]==Brick)?2:1 )+
-                                          g_score[tank_id][y][x];
-            }else{
+    // A tank in the way costs two extra turns: wait for it or go around.
+    // A tank's own cell is where its route starts, so the penalty only
+    // steers the other tanks. Cells in enemy firing lines cost extra too.
+    unsigned char cost[Size::cellCount];
+    memcpy(cost,enter_cost,sizeof(cost));
+    for(int side = 0; side < sideCount; ++side)
+        for(int tank = 0; tank < tankPerSide; ++tank)
+            if(tank_cell[side][tank] >= 0)
+                cost[tank_cell[side][tank]] += 2;
+    for(int cell = 0; cell < Size::cellCount; ++cell)
+        if(cost[cell])
+            cost[cell] = std::min(cost[cell]+threats.penalty[cell],(int)FlowField::maxCost);
+    int enemy = (mySide+1)%sideCount;
+    int enemy_base = Size::CellIndex(Size::BaseX(enemy),Size::BaseY(enemy));
+    int our_base = Size::CellIndex(Size::BaseX(mySide),Size::BaseY(mySide));
+    // Usually only a destroyed brick or two and the cells the tanks left
+    // and entered have changed, so repairing beats recomputing.
+    if(to_enemy_base.goal != enemy_base)
+        to_enemy_base.Compute(enemy_base,cost);
+    else
+        to_enemy_base.Update(cost);
+    if(to_our_base.goal != our_base)
+        to_our_base.Compute(our_base,cost);
+    else
+        to_our_base.Update(cost);
+  }
 
-                if(g_score[tank_id][_y][_x] > ((field->gameField[_y][_x]==Brick)?2:1 )+g_score[tank_id][y][x] ){
-                    g_score[tank_id][_y][_x] = ((field->gameField[_y][_x]==Brick)?2:1 )+g_score[tank_id][y][x];
-                    h_score[tank_id][_y][_x] = getEstimateScore(_x,_y,dst_x,dst_y);
-                    pfather[tank_id][_y][_x] = (i+2)%4;
-                }
-            }
-        }
-        if(open_list.find(make_pair(dst_x,dst_y))!=open_list.end()){
-            success = true;
-            break;
-        }else if(open_list.empty()){
-            success = false;
-            break;
-        }
-    }
-    if(success){
-        int xx = dst_x, yy = dst_y;
 
-        while(xx!=x0 || yy!=y0){
-            int tmp_x=xx,tmp_y =yy;
-            next_loc_x[tank_id].push_front(xx);
-            next_loc_y[tank_id].push_front(yy);
-            xx = xx+dx[pfather[tank_id][tmp_y][tmp_x]];
-            yy = yy+dy[pfather[tank_id][tmp_y][tmp_x]];
-        }
-    #ifdef DEBUG
-    
-        cout<<"A search succeeded."<<endl;
-        for(int i = 0 ;i < next_loc_x[tank_id].size();++i){
-            cout<<next_loc_x[tank_id][i]<<','<<next_loc_y[tank_id][i]<<endl;
-        }
-    #endif
-    }
-    #ifdef DEBUG
-    else{
-        cout<<"A search failed."<<endl;
-    }
-    #endif
-    memset(g_score,0,sizeof(g_score));
-    memset(h_score,0,sizeof(h_score));
-    memset(pfather,0,sizeof(pfather));
-  }
-  Action HeadQuarter::Explore(int tank_id){
-    if(first_move[tank_id] || (rand() %100) >90){
-        A_search(tank_id,baseX[(mySide+1)%2],baseY[(mySide+1)%2]); 
-        first_move[tank_id]=false;
-    }
-    
-    
+  template<int Height, int Width, int Sides, int Tanks>
+  Action BasicHeadQuarter<Height, Width, Sides, Tanks>::followFlow(int tank_id,const FlowField& flow,FieldItem shoot_at){
     int x0 = field->tankX[mySide][tank_id];
     int y0 = field->tankY[mySide][tank_id];
-    int next_x = next_loc_x[tank_id].front() ;
-    int next_y = next_loc_y[tank_id].front() ;
-    
+    int next = flow.NextCell(Size::CellIndex(x0,y0));
+    // no route to the target (e.g. walled in by steel or water)
+    if(next < 0)
+        return Stay;
+    int next_x = Size::CellX(next);
+    int next_y = Size::CellY(next);
+    #ifdef DEBUG
+        cout<<"Next step of "<<tank_id<<": "<<next_x<<','<<next_y<<" ("<<flow.distance[next]<<" to go)"<<endl;
+    #endif
+
     int next_move = 0;
     for(int i = 0 ; i < 4; ++i){
             if((x0+dx[i]==next_x) &&(y0+dy[i]==next_y))
                 next_move = i;
     }
 
-    if((field->gameField[next_y][next_x] & (Brick | Base))!=0){
+    if((field->gameField[next_y][next_x] & shoot_at)!=0){
         return (Action)(next_move+4); 
     }else if(field->gameField[next_y][next_x]==None){
-        next_loc_x[tank_id].pop_front();
-        next_loc_y[tank_id].pop_front();
         return (Action)next_move;
     }else{
         return (Action) -1;
     }
   }
+
+  template<int Height, int Width, int Sides, int Tanks>
+  void BasicHeadQuarter<Height, Width, Sides, Tanks>::planRoutes(){
+    if(route_turn == field->currentTurn)
+        return;
+    route_turn = field->currentTurn;
+    // Plan the exact turns needed to hit the enemy base: moving, shooting
+    // through bricks and waiting out the shot cooldown. Tanks go in order;
+    // a planned tank stops counting as a wall for the later ones, which
+    // avoid it through the reservations instead.
+    int enemy = (mySide+1)%sideCount;
+    int enemy_base = Size::CellIndex(Size::BaseX(enemy),Size::BaseY(enemy));
+    typename Size::Bitboard obstacles = field->obstacles;
+    bool reserving = false;
+    reserved.Clear();
+    for(int tank = 0; tank < tankPerSide; ++tank){
+        route_cost[tank] = -1;
+        if(!field->tankAlive[mySide][tank])
+            continue;
+        int from = Size::CellIndex(field->tankX[mySide][tank],field->tankY[mySide][tank]);
+        bool shot = ActionIsShoot(field->PreviousAction(field->currentTurn-1,mySide,tank));
+        // A tank stacked on the same cell still blocks it.
+        typename Size::Bitboard others = obstacles;
+        if(!cellShared(tank))
+            others.Reset(from);
+        route_cost[tank] = planner.Plan(from,shot,enemy_base,brick,blocked,
+                                         others,reserving ? &reserved : nullptr,threats.penalty);
+        #ifdef DEBUG
+            cout<<"Plan of "<<tank<<": "<<planner.length<<" turns, cost "<<route_cost[tank]<<endl;
+        #endif
+        if(route_cost[tank] <= 0)
+            continue;
+        route_step[tank] = planner.actions[0];
+        reserved.Reserve(from,planner.actions,planner.length,brick,others);
+        obstacles = others;
+        reserving = true;
+    }
+  }
+
+  template<int Height, int Width, int Sides, int Tanks>
+  Action BasicHeadQuarter<Height, Width, Sides, Tanks>::Explore(int tank_id){
+    // Other tanks can leave no plan at all (enemies count as walls), so
+    // fall back to the flow field then.
+    planRoutes();
+    if(route_cost[tank_id] > 0)
+        return route_step[tank_id];
+    return followFlow(tank_id,to_enemy_base,Brick | Base);
+  }
   
-  Action HeadQuarter::inShootRange(int tank_id,int e_tank_id){
+  template<int Height, int Width, int Sides, int Tanks>
+  Action BasicHeadQuarter<Height, Width, Sides, Tanks>::inShootRange(int tank_id,int e_tank_id){
       //Up shoot
       int x= field->tankX[mySide][tank_id];
       int y= field->tankY[mySide][tank_id];
-      int ex= field->tankX[(mySide+1)%2][e_tank_id];
-      int ey= field->tankY[(mySide+1)%2][e_tank_id];
+      int ex= field->tankX[e_tank_id/tankPerSide][e_tank_id%tankPerSide];
+      int ey= field->tankY[e_tank_id/tankPerSide][e_tank_id%tankPerSide];
       #ifdef DEBUG
       cout<<"My (x,y):"<<'('<<x<<','<<y<<')'<<endl;
       cout<<"enemy (x,y):"<<'('<<ex<<','<<ey<<')'<<endl;
       #endif
-      if(x==ex){
-        int i;
-        Action to_take = (ey>=y)?DownShoot:UpShoot;
-        for((ey>=y)?(i = y+1):(i=y-1);
-            (ey>=y)?(i<=ey):(i>=ey);
-            (ey>=y)?(i++):(i--)){
-            if((field->gameField[i][x] & (Steel|Brick | 
-            ((mySide==Blue)?(Blue0|Blue1):(Red0|Red1) ))) != 0){
-            auto tmp = RandAction(tank_id);
-            if(tmp == to_take) tmp = Stay;
-            return tmp;
-            }else{
-                if(i==ey)
-                return to_take;
-            }
-        }
-      }
-      if(ey==y){
-        int i;
-        Action to_take = (ex>=x)?RightShoot:LeftShoot;
-        for((ex>=x)? (i =x+1):(i = x-1);
-           (ex>=x)?(i<=ex):(i>=ex);
-           (ex>=x)?(i++):(i--)){
-            if((field->gameField[y][i] & (Steel|Brick | 
-            ((mySide==Blue)?(Blue0|Blue1):(Red0|Red1) ))) != 0){
-            auto tmp = RandAction(tank_id);
-            if(tmp == to_take) tmp = Stay;
-            return tmp;
-            }else{
-                if(i==ex)
-                return to_take;
-            }
-        }
-      }
-      
-    return Stay;
-
+      int dir;
+      if(x==ex && y!=ey)
+        dir = (ey>y)?Down:Up;
+      else if(y==ey && x!=ex)
+        dir = (ex>x)?Right:Left;
+      else
+        return Stay;
 
+      // The bullet stops at the first obstacle on the ray (see the attack
+      // map); shoot only if that cell holds an enemy (tank or base) and
+      // none of ours. No target means we fired last turn and must wait.
+      Action to_take = (Action)(dir+UpShoot);
+      int target = attacks.target[mySide][tank_id][dir];
+      if(target < 0)
+        return Stay;
+      FieldItem items = field->gameField[Size::CellY(target)][Size::CellX(target)];
+      FieldItem ours = None, theirs = None;
+      for(int side = 0; side < sideCount; ++side)
+        for(int tank = 0; tank < tankPerSide; ++tank)
+          if(side==mySide) ours |= Size::TankItem(side,tank);
+          else theirs |= Size::TankItem(side,tank);
+      bool enemyBase = (items & Base) != 0 &&
+        target != Size::CellIndex(Size::BaseX(mySide),Size::BaseY(mySide));
+      if((items & ours) == 0 && ((items & theirs) != 0 || enemyBase))
+        return to_take;
+      auto tmp = RandAction(*field,tank_id,rng);
+      if(tmp == to_take) tmp = Stay;
+      return tmp;
   }
 
-  Action HeadQuarter::Attack(int tank_id){
+  template<int Height, int Width, int Sides, int Tanks>
+  Action BasicHeadQuarter<Height, Width, Sides, Tanks>::Attack(int tank_id){
     int move = -1;
     if((move = inShootRange(tank_id,aim[tank_id][0])) != Stay){
         return (Action)move;
@@ -1124,62 +4212,55 @@ enum AgentState{
     }
   }
 
-  Action HeadQuarter::Defend(int tank_id){
-    A_search(tank_id,baseX[mySide],baseY[mySide]);
-    
-    int x0 = field->tankX[mySide][tank_id];
-    int y0 = field->tankY[mySide][tank_id];
-    int next_x = next_loc_x[tank_id].front() ;
-    int next_y = next_loc_y[tank_id].front() ;
-    
-    int next_move = 0;
-    for(int i = 0 ; i < 4; ++i){
-            if((x0+dx[i]==next_x) &&(y0+dy[i]==next_y))
-                next_move = i;
-    }
-
-    if((field->gameField[next_y][next_x] & (Brick ))!=0){
-        return (Action)(next_move+4); 
-    }else if(field->gameField[next_y][next_x]==None){
-        next_loc_x[tank_id].pop_front();
-        next_loc_y[tank_id].pop_front();
-        return (Action)next_move;
-    }else{
-        return (Action) -1;
-    }
+  template<int Height, int Width, int Sides, int Tanks>
+  Action BasicHeadQuarter<Height, Width, Sides, Tanks>::Defend(int tank_id){
+    return followFlow(tank_id,to_our_base,Brick);
   }
 
-  HeadQuarter* hq = new HeadQuarter;
+  typedef BasicHeadQuarter<fieldHeight, fieldWidth, sideCount, tankPerSide> HeadQuarter;
 
 }
 
 
 
+// 其他工具（如 tank2_perft.cpp）可以定义 TANK2_NO_MAIN 后 #include 本文件，复用引擎和 AI
+#ifndef TANK2_NO_MAIN
 int main()
 {
     //freopen("debug.in","r",stdin);
     #ifdef DEBUG
     freopen("debug.in","r",stdin);
     #endif
-    srand((unsigned)time(nullptr));
+        TankGame::GameContext game;
+        std::unique_ptr<TankGame::HeadQuarter> hq;
+        int hq_field = 0;
         bool first_round = true;
         string data, globaldata;
         while(true){
             if(first_round){
-                TankGame::ReadInput(cin, data, globaldata);
-                TankGame::hq->mySide = TankGame::field->mySide;
+                TankGame::ReadInput(game, cin, data, globaldata);
                 first_round = false;
+            }else{
+                TankGame::ReadInput_longlive(game, cin);
+            }
+            // A request carrying a map replaces game.field: start the agent
+            // afresh on the new field instead of keeping a dangling pointer.
+            if(!hq || hq_field != game.fieldCount){
+                hq.reset(new TankGame::HeadQuarter());
+                hq->rng.seed((unsigned)time(nullptr) + game.fieldCount);
+                hq->field = game.field;
+                hq->mySide = game.field->mySide;
+                hq_field = game.fieldCount;
         #ifdef DEBUG
-            cout<<TankGame::field->mySide<<endl;
-            TankGame::field->DebugPrint();
-            printf("Tank 0: %d, tank 1 : %d \n",TankGame::hq->cur_state[0],TankGame::hq->cur_state[1]);
+            cout<<game.field->mySide<<endl;
+            game.field->DebugPrint();
+            printf("Tank 0: %d, tank 1 : %d \n",hq->cur_state[0],hq->cur_state[1]);
         #endif
-            }else{
-                TankGame::ReadInput_longlive(cin);
             }
-            TankGame::SubmitAndDontExit(TankGame::hq->takeAction(0),TankGame::hq->takeAction(1));
+            TankGame::SubmitAndDontExit(game, hq->takeAction(0),hq->takeAction(1));
             cout << flush;
         }
     
 
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,729 @@
+// Tank2 引擎的差分模糊测试
+// 在随机地图上随机地下合法的棋，检查：
+//   1. TankField::Revert 能否精确回到之前的局面（operator!=、哈希、障碍位棋盘）
+//   2. 其他引擎（BitTankField、TankState、TankBatch）每一回合是否都与 TankField 一致
+//   3. 随砖块被摧毁增量更新的 DistanceTable、FlowField 是否与重建的一致，PathSearch、FlowField 是否与表一致
+//   4. 左右对称的局面上，JointActionIterator 按 PruneSymmetric 剪枝后得到的后继局面是否一个不少
+//   5. ActionPlanner 的动作序列（含加上 ThreatMap 代价的）是否合法、是否恰好按规划的回合数击毁对方基地、代价是否与执行时逐回合累计的相同，
+//      按预约表协作规划的两个坦克是否互不妨碍；ThreatMap 是否与对方每种走法之后的攻击图一致
+// 最后重放同样的对局，报告每种引擎每秒模拟的回合数
+// 新的引擎实现加入时，在 CheckTurn 和 Benchmark 里各加一项即可
+// 编译：g++ -O2 -std=c++11 -o tank2_fuzz tank2_fuzz.cpp（加 -mavx2 测试 TankBatch 的向量化路径）
+// 用法：tank2_fuzz [对局数] [随机种子]
+
+#define TANK2_NO_MAIN
+#include "tank2_FSM.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace Fuzz
+{
+    using namespace TankGame;
+
+    // 同时进行的对局数，也是 TankBatch 的大小
+    const int laneCount = 64;
+
+    // 一局的地图和每回合的联合动作，用于重放测速
+    struct GameRecord
+    {
+        int hasBrick[3], hasWater[3], hasSteel[3];
+        vector<JointAction> turns;
+    };
+
+    struct Stats
+    {
+        long long games = 0, turns = 0, reverts = 0;
+
+        // 用于确认覆盖到了规则的边角情况
+        long long stacked = 0, headOn = 0, multiKill = 0, baseKill = 0;
+
+        // 检查过的对称局面，其中全部的和被 PruneSymmetric 剪掉的联合动作
+        long long mirrored = 0, joints = 0, prunedJoints = 0;
+
+        // 各种结束原因的对局数，下标为 GameEndReason
+        long long endReason[8] = {};
+    };
+
+    struct Lane
+    {
+        GameRecord record;
+        TankField* reference;
+        TankField* initial;
+        BitTankField* bit;
+        TankState state;
+
+        // 随对局增量更新的最短路表，和朝对方基地、加上坦克代价的距离场
+        DistanceTable distances;
+        FlowField flow;
+    };
+
+    Stats stats;
+    vector<GameRecord> records;
+
+    void Fail(const Lane& lane, const char* what)
+    {
+        printf("DIVERGENCE: %s (game %lld, turn %d)\n", what, stats.games, lane.reference->currentTurn);
+        printf("map: brick %d %d %d, water %d %d %d, steel %d %d %d\n",
+            lane.record.hasBrick[0], lane.record.hasBrick[1], lane.record.hasBrick[2],
+            lane.record.hasWater[0], lane.record.hasWater[1], lane.record.hasWater[2],
+            lane.record.hasSteel[0], lane.record.hasSteel[1], lane.record.hasSteel[2]);
+        lane.reference->DebugPrint();
+        exit(1);
+    }
+
+    // 随机地图，砖块较多，钢墙和水较少
+    void NewGame(Lane& lane, TankBatch& batch, int index)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            lane.record.hasBrick[i] = (rand() & rand()) % (1 << 27);
+            lane.record.hasWater[i] = (rand() & rand() & rand()) % (1 << 27);
+            lane.record.hasSteel[i] = (rand() & rand() & rand()) % (1 << 27);
+        }
+        lane.record.turns.clear();
+        delete lane.reference;
+        delete lane.initial;
+        delete lane.bit;
+        lane.reference = new TankField(lane.record.hasBrick, lane.record.hasWater, lane.record.hasSteel, 0);
+        lane.initial = new TankField(*lane.reference);
+        lane.bit = new BitTankField(*lane.reference);
+        lane.reference->ExportState(lane.state);
+        lane.distances.Build(lane.state.brick, lane.state.steel | lane.state.water);
+        lane.flow.goal = -1;
+        batch.Load(index, lane.state);
+    }
+
+    // 一半概率均匀随机，一半概率靠近并射击最近的坦克，以便制造叠在一起的坦克和对射
+    Action PickAction(const TankState& state, int side, int tank, unsigned short mask)
+    {
+        int cell = state.tankCell[side][tank];
+        Bitboard obstacles = state.Occupied() - state.water;
+
+        // 随机地图上基地往往没有掩护，大多数时候不打基地，否则对局只有一两回合
+        if (cell >= 0 && rand() % 8)
+            for (int dir = 0; dir < 4; dir++)
+            {
+                int target = FirstObstacle(cell, dir, obstacles);
+                for (int s = 0; s < sideCount; s++)
+                    if (target == CellIndex(baseX[s], baseY[s]))
+                        mask &= ~ActionBit((Action)(dir + UpShoot));
+            }
+
+        if (cell >= 0 && rand() % 2)
+        {
+            int best = -1, bestDist = 1 << 30;
+            for (int s = 0; s < sideCount; s++)
+                for (int t = 0; t < tankPerSide; t++)
+                {
+                    int other = state.tankCell[s][t];
+                    if (other < 0 || (s == side && t == tank))
+                        continue;
+                    int dist = abs(CellX(other) - CellX(cell)) + abs(CellY(other) - CellY(cell));
+                    if (dist < bestDist)
+                    {
+                        best = other;
+                        bestDist = dist;
+                    }
+                }
+            if (best >= 0)
+            {
+                for (int dir = 0; dir < 4; dir++)
+                {
+                    Action shoot = (Action)(dir + UpShoot);
+                    if ((mask & ActionBit(shoot)) && FirstObstacle(cell, dir, obstacles) == best)
+                        return shoot;
+                }
+                for (int dir = 0; dir < 4; dir++)
+                {
+                    int next = rayTable.neighbor[cell][dir];
+                    if ((mask & ActionBit((Action)dir)) &&
+                        abs(CellX(best) - CellX(next)) + abs(CellY(best) - CellY(next)) < bestDist)
+                        return (Action)dir;
+                }
+            }
+        }
+
+        int count = 0;
+        for (int act = Stay; act <= LeftShoot; act++)
+            count += !!(mask & ActionBit((Action)act));
+        int pick = rand() % count;
+        for (int act = Stay; act <= LeftShoot; act++)
+            if ((mask & ActionBit((Action)act)) && pick-- == 0)
+                return (Action)act;
+        return Stay;
+    }
+
+    // 所有坦克都不动的联合动作
+    JointAction StayAll()
+    {
+        JointAction stay;
+        for (int side = 0; side < sideCount; side++)
+            for (int tank = 0; tank < tankPerSide; tank++)
+                stay.act[side][tank] = Stay;
+        return stay;
+    }
+
+    // 其他坦克不动，0 方的坦克各自照着 plans[tank]（为空的不动）在 s 上执行 length 个回合
+    // 每个回合执行前先调用 check(s, i) 检查局面，返回 false 时停下；有不合法的动作时不执行并返回 false
+    template<typename Check>
+    bool ExecutePlans(TankState& s, const Action* const (&plans)[tankPerSide], int length, Check check)
+    {
+        for (int i = 0; i < length; i++)
+        {
+            if (!check(s, i))
+                return false;
+            JointAction step = StayAll();
+            for (int tank = 0; tank < tankPerSide; tank++)
+                if (plans[tank])
+                {
+                    if (!s.ActionIsValid(0, tank, plans[tank][i]))
+                        return false;
+                    step.act[0][tank] = plans[tank][i];
+                }
+            s.Apply(step);
+        }
+        return true;
+    }
+
+    // 把局面改成左右对称（右半边照抄左半边，每方 1 号坦克放到 0 号坦克的镜像位置），
+    // 检查 PruneSymmetric 剪枝前后枚举到的后继局面按 CanonicalKey 是同一个集合
+    // 隔一次清空坦克所在的行，制造左右都打不到东西的射击（镜像中被 PruneUselessShots 剪掉的那种）
+    void CheckSymmetryPruning(const Lane& lane)
+    {
+        TankState s = lane.state, mirror = lane.state.Transformed(1);
+        Bitboard right = {}, rows = {};
+        for (int cell = 0; cell < cellCount; cell++)
+        {
+            if (CellX(cell) > fieldWidth / 2)
+                right.Set(cell);
+            for (int side = 0; side < sideCount && stats.mirrored % 2; side++)
+                if (s.tankCell[side][0] >= 0 && CellY(cell) == CellY(s.tankCell[side][0]))
+                    rows.Set(cell);
+        }
+        s.brick = (s.brick - right - rows) | ((mirror.brick & right) - rows);
+        s.steel = (s.steel - right - rows) | ((mirror.steel & right) - rows);
+        s.water = (s.water - right - rows) | ((mirror.water & right) - rows);
+        for (int side = 0; side < sideCount; side++)
+        {
+            int cell = s.tankCell[side][0], image = mirror.tankCell[side][0];
+            s.tankCell[side][1] = image;
+            s.lastShot = (s.lastShot & ~(1u << (side * tankPerSide + 1))) |
+                (s.lastShot >> (side * tankPerSide) & 1) << (side * tankPerSide + 1);
+            if (cell >= 0)
+            {
+                Bitboard tanks = {};
+                tanks.Set(cell);
+                tanks.Set(image);
+                s.brick -= tanks;
+                s.steel -= tanks;
+                s.water -= tanks;
+            }
+        }
+
+        unsigned short masks[sideCount][tankPerSide];
+        ActionSymmetry symmetry;
+        s.GetLegalActionMasks(masks, PruneDeadTanks | PruneUselessShots | PruneSymmetric, &symmetry);
+        if (!symmetry.active)
+            Fail(lane, "PruneSymmetric missed a mirrored position");
+        vector<unsigned long long> successors[2];
+        for (int pass = 0; pass < 2; pass++)
+        {
+            JointActionIterator it(masks, pass ? &symmetry : nullptr);
+            JointAction joint;
+            while (it.Next(joint))
+            {
+                TankState next = s;
+                if (!next.Apply(joint))
+                    Fail(lane, "JointActionIterator produced an illegal joint action");
+                successors[pass].push_back(next.CanonicalKey());
+            }
+        }
+        stats.mirrored++;
+        stats.joints += successors[0].size();
+        stats.prunedJoints += successors[0].size() - successors[1].size();
+        for (int pass = 0; pass < 2; pass++)
+        {
+            sort(successors[pass].begin(), successors[pass].end());
+            successors[pass].erase(unique(successors[pass].begin(), successors[pass].end()), successors[pass].end());
+        }
+        if (successors[0] != successors[1])
+            Fail(lane, "PruneSymmetric lost a successor position");
+    }
+
+    // 统计这一回合出现的边角情况（局面为执行后的局面）
+    void CountEdgeCases(const TankState& before, const TankState& after, const JointAction& joint)
+    {
+        int killed = 0;
+        for (int side = 0; side < sideCount; side++)
+        {
+            if ((before.baseAlive >> side & 1) && !(after.baseAlive >> side & 1))
+                stats.baseKill++;
+            for (int tank = 0; tank < tankPerSide; tank++)
+            {
+                killed += before.tankCell[side][tank] >= 0 && after.tankCell[side][tank] < 0;
+                for (int t = tank + 1; t < tankPerSide; t++)
+                    if (after.tankCell[side][tank] >= 0 && after.tankCell[side][tank] == after.tankCell[side][t])
+                        stats.stacked++;
+                for (int t = 0; t < tankPerSide; t++)
+                    if (after.tankCell[side][tank] >= 0 && after.tankCell[side][tank] == after.tankCell[1 - side][t])
+                        stats.stacked++;
+            }
+        }
+        if (killed > 1)
+            stats.multiKill++;
+
+        // 对射：两个坦克互相射击对方且都活了下来
+        Bitboard obstacles = after.Occupied() - after.water;
+        for (int tank = 0; tank < tankPerSide; tank++)
+        {
+            Action act = joint.act[Blue][tank];
+            int cell = after.tankCell[Blue][tank];
+            if (cell < 0 || !ActionIsShoot(act))
+                continue;
+            int target = FirstObstacle(cell, ExtractDirectionFromAction(act), obstacles);
+            for (int t = 0; t < tankPerSide; t++)
+                if (target >= 0 && after.tankCell[Red][t] == target &&
+                    ActionDirectionIsOpposite(act, joint.act[Red][t]))
+                    stats.headOn++;
+        }
+    }
+
+    // 用 TankField 执行一回合，并与其他引擎逐一比较
+    void CheckTurn(Lane& lane, const JointAction& joint, const TankState& batchState, bool batchValid)
+    {
+        TankField& f = *lane.reference;
+        for (int side = 0; side < sideCount; side++)
+            for (int tank = 0; tank < tankPerSide; tank++)
+                f.nextAction[side][tank] = lane.bit->nextAction[side][tank] = joint.act[side][tank];
+
+        if (stats.turns % 16 == 0)
+            CheckSymmetryPruning(lane);
+
+        // 随机抽查 Revert
+        if (rand() % 4 == 0)
+        {
+            TankField before(f);
+            if (!f.DoAction())
+                Fail(lane, "TankField rejected a legal joint action");
+            if (!f.Revert())
+                Fail(lane, "TankField::Revert failed");
+            if (f != before || f.hash != before.hash || f.obstacles != before.obstacles ||
+                f.baseLost != before.baseLost || f.tanksLost != before.tanksLost)
+                Fail(lane, "TankField::Revert did not restore the position");
+            stats.reverts++;
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    f.nextAction[side][tank] = joint.act[side][tank];
+        }
+
+        // Preview（const）的结果应与随后的 DoAction 一致
+        TankField::TurnPreview preview = f.Preview(joint);
+        TankState previous;
+        f.ExportState(previous);
+        if (!preview.valid)
+            Fail(lane, "Preview rejected a legal joint action");
+
+        if (!f.DoAction())
+            Fail(lane, "TankField rejected a legal joint action");
+        if (f.hash != f.ComputeHash())
+            Fail(lane, "incremental hash differs from ComputeHash");
+        for (int side = 0; side < sideCount; side++)
+        {
+            if ((preview.destroyedBases >> side & 1) != ((previous.baseAlive >> side & 1) && !f.baseAlive[side]))
+                Fail(lane, "Preview destroyed bases differ from DoAction");
+            for (int tank = 0; tank < tankPerSide; tank++)
+            {
+                int cell = f.tankAlive[side][tank] ? CellIndex(f.tankX[side][tank], f.tankY[side][tank]) : -1;
+                bool destroyed = previous.tankCell[side][tank] >= 0 && !f.tankAlive[side][tank];
+                if (preview.tankCell[side][tank] != cell ||
+                    (preview.destroyedTanks >> (side * tankPerSide + tank) & 1) != destroyed)
+                    Fail(lane, "Preview tanks differ from DoAction");
+            }
+        }
+        for (int cell = 0; cell < cellCount; cell++)
+            if (preview.destroyedBricks.Test(cell) != (previous.brick.Test(cell) && !(f.gameField[CellY(cell)][CellX(cell)] & Brick)))
+                Fail(lane, "Preview destroyed bricks differ from DoAction");
+        if (preview.result != f.GetGameResult() || preview.endReason != f.GetEndReason())
+            Fail(lane, "Preview result differs from DoAction");
+        for (int side = 0; side < sideCount; side++)
+            for (int tank = 0; tank < tankPerSide; tank++)
+                if (f.PreviousAction(f.currentTurn - 1, side, tank) != joint.act[side][tank])
+                    Fail(lane, "action history differs from the joint action");
+
+        // BitTankField
+        if (!lane.bit->DoAction())
+            Fail(lane, "BitTankField rejected a legal joint action");
+        if (*lane.bit != f || lane.bit->GetGameResult() != f.GetGameResult() ||
+            lane.bit->GetEndReason() != f.GetEndReason())
+            Fail(lane, "BitTankField differs from TankField");
+
+        // TankState
+        TankState expected, before = lane.state;
+        f.ExportState(expected);
+        if (!lane.state.Apply(joint))
+            Fail(lane, "TankState rejected a legal joint action");
+        if (memcmp(&lane.state, &expected, sizeof(TankState)) != 0 || lane.state.GetGameResult() != f.GetGameResult() ||
+            lane.state.GetEndReason() != f.GetEndReason())
+            Fail(lane, "TankState differs from TankField");
+        TankState::AttackMap attacks;
+        lane.state.GetAttackMap(attacks);
+        TankField::AttackMap fieldAttacks;
+        f.GetAttackMap(fieldAttacks);
+        if (memcmp(attacks.ray, fieldAttacks.ray, sizeof(attacks.ray)) != 0 ||
+            memcmp(attacks.target, fieldAttacks.target, sizeof(attacks.target)) != 0 ||
+            memcmp(attacks.threat, fieldAttacks.threat, sizeof(attacks.threat)) != 0)
+            Fail(lane, "TankField attack map differs from TankState");
+
+        // 逐格走一遍射线，独立验证攻击图的终点
+        for (int side = 0; side < sideCount; side++)
+            for (int tank = 0; tank < tankPerSide; tank++)
+                for (int dir = 0; dir < 4; dir++)
+                {
+                    int expectedTarget = -1;
+                    if (f.tankAlive[side][tank] && !ActionIsShoot(f.PreviousAction(f.currentTurn - 1, side, tank)))
+                        for (int x = f.tankX[side][tank] + dx[dir], y = f.tankY[side][tank] + dy[dir];
+                            CoordValid(x, y); x += dx[dir], y += dy[dir])
+                            if (f.gameField[y][x] & ~Water)
+                            {
+                                expectedTarget = CellIndex(x, y);
+                                break;
+                            }
+                    if (fieldAttacks.target[side][tank][dir] != expectedTarget)
+                        Fail(lane, "attack map target differs from a walk along the ray");
+                }
+
+        // 增量更新的最短路表应与重建的一致
+        lane.distances.Sync(expected.brick);
+        if (rand() % 8 == 0)
+        {
+            static DistanceTable rebuilt;
+            rebuilt.Build(expected.brick, expected.steel | expected.water);
+            if (memcmp(rebuilt.distance, lane.distances.distance, sizeof(rebuilt.distance)) != 0)
+                Fail(lane, "incrementally updated distance table differs from a rebuild");
+        }
+
+        // 不额外挡住格子时，PathSearch 的结果应与表一致，路径的代价之和等于结果
+        for (int side = 0; side < sideCount; side++)
+        {
+            static PathSearch search;
+            int from = expected.tankCell[side][0], to = rand() % cellCount;
+            if (from < 0)
+                continue;
+            int cost = search.Search(from, to, expected.brick, expected.steel | expected.water);
+            int table = lane.distances.distance[from][to];
+            if (cost != (table == DistanceTable::unreachable ? -1 : table))
+                Fail(lane, "PathSearch differs from the distance table");
+            int route[cellCount], length = search.Route(route), sum = 0;
+            for (int i = 0; i < length; i++)
+                sum += lane.distances.Cost(route[i]);
+            if (cost > 0 && (sum != cost || route[length - 1] != to))
+                Fail(lane, "PathSearch route does not add up to its cost");
+        }
+
+        // 用表的代价算出的 FlowField 应与表中到目标的一列一致（基地和不能进入的格子作为起点没有意义）
+        {
+            static FlowField flow;
+            int goal = rand() % cellCount;
+            flow.Compute(goal, lane.distances.cost);
+            for (int cell = 0; cell < cellCount; cell++)
+                if (lane.distances.cost[cell] && !lane.distances.bases.Test(cell) &&
+                    flow.distance[cell] != lane.distances.distance[cell][goal])
+                    Fail(lane, "FlowField differs from the distance table");
+        }
+
+        // 每回合增量修复的距离场应与从头计算的一致
+        {
+            static FlowField rebuilt;
+            unsigned char cost[cellCount];
+            memcpy(cost, lane.distances.cost, sizeof(cost));
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    if (expected.tankCell[side][tank] >= 0)
+                        cost[expected.tankCell[side][tank]] += 2;
+            int goal = CellIndex(baseX[1], baseY[1]);
+            if (lane.flow.goal != goal)
+                lane.flow.Compute(goal, cost);
+            else
+                lane.flow.Update(cost);
+            rebuilt.Compute(goal, cost);
+            if (memcmp(rebuilt.distance, lane.flow.distance, sizeof(rebuilt.distance)) != 0)
+                Fail(lane, "incrementally updated FlowField differs from Compute");
+        }
+
+        // 威胁图应等于：对方坦克现在的射线，并上它们每种走法（含不动）之后、不论冷却的射线
+        static ThreatMap threats;
+        threats.Compute(attacks, expected.tankCell, 0, expected.Occupied() - expected.water, expected.steel | expected.water);
+        if (expected.turn <= turnCapacity)
+        {
+            Bitboard reach = attacks.threat[1];
+            for (int tank = 0; tank < tankPerSide; tank++)
+                for (int act = Stay; act <= Left && expected.tankCell[1][tank] >= 0; act++)
+                {
+                    if (!expected.ActionIsValid(1, tank, (Action)act))
+                        continue;
+                    TankState moved = expected;
+                    JointAction step = StayAll();
+                    step.act[1][tank] = (Action)act;
+                    moved.Apply(step);
+                    moved.lastShot = 0;
+                    TankState::AttackMap after;
+                    moved.GetAttackMap(after);
+                    for (int dir = 0; dir < 4; dir++)
+                        reach |= after.ray[1][tank][dir];
+                }
+            if (!(threats.now == attacks.threat[1]) || !((threats.now | threats.next) == reach))
+                Fail(lane, "ThreatMap differs from the attack maps after each enemy move");
+        }
+
+        // 其他坦克不动时，ActionPlanner 给出的动作序列应逐回合合法，并恰好在最后一回合击毁对方基地
+        if (expected.tankCell[0][0] >= 0 && (expected.baseAlive & 3) == 3)
+        {
+            // 障碍不含要规划的坦克本身（与其他坦克同格时该格仍是障碍）
+            static ActionPlanner planner, weighted;
+            TankState rest = expected;
+            rest.tankCell[0][0] = -1;
+            Bitboard obstacles = rest.Occupied() - rest.water;
+            int turns = planner.Plan(expected.tankCell[0][0], expected.lastShot & 1, CellIndex(baseX[1], baseY[1]),
+                expected.brick, expected.steel | expected.water, obstacles);
+
+            // 加上威胁图的代价后回合数不会更少
+            int cost = weighted.Plan(expected.tankCell[0][0], expected.lastShot & 1, CellIndex(baseX[1], baseY[1]),
+                expected.brick, expected.steel | expected.water, obstacles, nullptr, threats.penalty);
+            if ((cost < 0) != (turns < 0) || (cost >= 0 && weighted.length < turns))
+                Fail(lane, "ActionPlanner with threat penalties disagrees with the plain plan");
+
+            // 执行时逐回合累计代价：每个回合结束时（射中基地的最后一个回合除外）加上坦克所在格子的 penalty
+            const ActionPlanner* plans[] = { &planner, &weighted };
+            for (const ActionPlanner* plan : plans)
+                if (plan->length > 0 && expected.turn + plan->length <= turnCapacity)
+                {
+                    TankState s = expected;
+                    const Action* actions[tankPerSide] = { plan->actions };
+                    int paid = plan->length;
+                    if (!ExecutePlans(s, actions, plan->length, [&](const TankState& s, int i)
+                        {
+                            if (i)
+                                paid += std::min((int)threats.penalty[s.tankCell[0][0]], (int)ActionPlanner::maxPenalty);
+                            return s.baseAlive == 3 && s.tankCell[0][0] >= 0;
+                        }))
+                        Fail(lane, "ActionPlanner produced an illegal plan");
+                    if (s.baseAlive != 1)
+                        Fail(lane, "ActionPlanner plan does not destroy the enemy base");
+                    if (plan == &weighted && paid != cost)
+                        Fail(lane, "ActionPlanner cost differs from the penalties along the executed plan");
+                }
+
+            // 另一个坦克照着预约表避让时，两个坦克在窗口内同时照着规划行动应逐回合合法，不同格，也不互相打中
+            // 一半的时候两个坦克都加上威胁图的代价（此时代价不等于回合数）
+            int other = expected.tankCell[0][1];
+            if (turns > 0 && other >= 0 && other != expected.tankCell[0][0])
+            {
+                static ReservationTable reserved;
+                static Action first[ActionPlanner::maxLength];
+                const unsigned char* penalty = rand() % 2 ? threats.penalty : nullptr;
+                const ActionPlanner& plan = penalty ? weighted : planner;
+                int firstLength = plan.length;
+                memcpy(first, plan.actions, sizeof(Action) * firstLength);
+                reserved.Clear();
+                reserved.Reserve(expected.tankCell[0][0], first, firstLength, expected.brick, obstacles);
+                rest.tankCell[0][1] = -1;
+                obstacles = rest.Occupied() - rest.water;
+                int second = planner.Plan(other, expected.lastShot >> 1 & 1, CellIndex(baseX[1], baseY[1]),
+                    expected.brick, expected.steel | expected.water, obstacles, &reserved, penalty);
+                int window = std::min(std::min(firstLength, planner.length), (int)ReservationTable::horizon);
+                if (second > 0 && expected.turn + window <= turnCapacity)
+                {
+                    TankState s = expected;
+                    const Action* actions[tankPerSide] = { first, planner.actions };
+                    if (!ExecutePlans(s, actions, window, [&](const TankState& s, int i)
+                        {
+                            if (s.baseAlive != 3 || s.tankCell[0][0] < 0 || s.tankCell[0][1] < 0 ||
+                                (i && s.tankCell[0][0] == s.tankCell[0][1]))
+                                Fail(lane, "cooperative plans collide");
+                            return true;
+                        }))
+                        Fail(lane, "cooperative plans block each other");
+                    if ((s.baseAlive & 1) == 0 || s.tankCell[0][0] < 0 || s.tankCell[0][1] < 0 ||
+                        (s.baseAlive == 3 && s.tankCell[0][0] == s.tankCell[0][1]))
+                        Fail(lane, "cooperative plans collide");
+                }
+            }
+        }
+
+        // TankBatch
+        if (!batchValid)
+            Fail(lane, "TankBatch rejected a legal joint action");
+        if (memcmp(&batchState, &expected, sizeof(TankState)) != 0)
+            Fail(lane, "TankBatch differs from TankField");
+
+        CountEdgeCases(before, expected, joint);
+        lane.record.turns.push_back(joint);
+        stats.turns++;
+    }
+
+    // 对局结束时一路回退到开局，检查整局的回退记录
+    void FinishGame(Lane& lane)
+    {
+        stats.endReason[lane.reference->GetEndReason()]++;
+        while (lane.reference->Revert())
+            ;
+        while (lane.bit->Revert())
+            ;
+        if (*lane.reference != *lane.initial || lane.reference->hash != lane.initial->hash ||
+            lane.reference->GetEndReason() != NotEnded)
+            Fail(lane, "TankField did not revert to the initial position");
+        if (*lane.bit != *lane.initial)
+            Fail(lane, "BitTankField did not revert to the initial position");
+        records.push_back(lane.record);
+        stats.games++;
+    }
+
+    double Seconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // 各引擎重放全部对局的速度
+    void Benchmark()
+    {
+        long long turns = 0;
+        for (auto& r : records)
+            turns += r.turns.size();
+        printf("%-14s %14s\n", "engine", "turns/s");
+
+        double seconds = 0;
+        for (auto& r : records)
+        {
+            TankField* f = new TankField(r.hasBrick, r.hasWater, r.hasSteel, 0);
+            auto start = std::chrono::steady_clock::now();
+            for (auto& joint : r.turns)
+            {
+                memcpy(f->nextAction, joint.act, sizeof(joint.act));
+                f->DoAction();
+            }
+            seconds += Seconds(start);
+            delete f;
+        }
+        printf("%-14s %14.0f\n", "TankField", turns / seconds);
+
+        seconds = 0;
+        for (auto& r : records)
+        {
+            BitTankField* f = new BitTankField(r.hasBrick, r.hasWater, r.hasSteel, 0);
+            auto start = std::chrono::steady_clock::now();
+            for (auto& joint : r.turns)
+            {
+                memcpy(f->nextAction, joint.act, sizeof(joint.act));
+                f->DoAction();
+            }
+            seconds += Seconds(start);
+            delete f;
+        }
+        printf("%-14s %14.0f\n", "BitTankField", turns / seconds);
+
+        vector<TankState> initial(records.size());
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            TankField* f = new TankField(records[i].hasBrick, records[i].hasWater, records[i].hasSteel, 0);
+            f->ExportState(initial[i]);
+            delete f;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            TankState state = initial[i];
+            for (auto& joint : records[i].turns)
+                state.Apply(joint);
+        }
+        printf("%-14s %14.0f\n", "TankState", turns / Seconds(start));
+
+        // 每 laneCount 局一批同步推进，提前结束的局用 Stay 填充（不计入回合数）
+        seconds = 0;
+        JointAction stay = StayAll();
+        for (size_t first = 0; first < records.size(); first += laneCount)
+        {
+            int n = (int)std::min(records.size() - first, (size_t)laneCount);
+            TankBatch batch(n);
+            size_t longest = 0;
+            for (int g = 0; g < n; g++)
+            {
+                batch.Load(g, initial[first + g]);
+                longest = std::max(longest, records[first + g].turns.size());
+            }
+            vector<JointAction> joints(n);
+            vector<char> valid(n);
+            auto batchStart = std::chrono::steady_clock::now();
+            for (size_t t = 0; t < longest; t++)
+            {
+                for (int g = 0; g < n; g++)
+                    joints[g] = t < records[first + g].turns.size() ? records[first + g].turns[t] : stay;
+                batch.Step(joints.data(), (bool*)valid.data());
+            }
+            seconds += Seconds(batchStart);
+        }
+#ifdef __AVX2__
+        printf("%-14s %14.0f  (AVX2)\n", "TankBatch", turns / seconds);
+#else
+        printf("%-14s %14.0f  (scalar)\n", "TankBatch", turns / seconds);
+#endif
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace Fuzz;
+
+    long long gameLimit = argc > 1 ? atoll(argv[1]) : 2000;
+    unsigned seed = argc > 2 ? (unsigned)atoi(argv[2]) : (unsigned)time(nullptr);
+    srand(seed);
+    printf("seed %u\n", seed);
+
+    vector<Lane> lanes(laneCount);
+    TankBatch batch(laneCount);
+    for (int i = 0; i < laneCount; i++)
+    {
+        lanes[i].reference = lanes[i].initial = nullptr;
+        lanes[i].bit = nullptr;
+        NewGame(lanes[i], batch, i);
+    }
+
+    vector<JointAction> joints(laneCount);
+    vector<char> valid(laneCount);
+    while (stats.games < gameLimit)
+    {
+        for (int i = 0; i < laneCount; i++)
+        {
+            unsigned short masks[sideCount][tankPerSide];
+            lanes[i].state.GetLegalActionMasks(masks);
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    joints[i].act[side][tank] = PickAction(lanes[i].state, side, tank, masks[side][tank]);
+        }
+        batch.Step(joints.data(), (bool*)valid.data());
+        for (int i = 0; i < laneCount; i++)
+        {
+            TankState batchState;
+            batch.Store(i, batchState);
+            CheckTurn(lanes[i], joints[i], batchState, valid[i] != 0);
+            if (lanes[i].reference->GetGameResult() != NotFinished)
+            {
+                FinishGame(lanes[i]);
+                NewGame(lanes[i], batch, i);
+            }
+        }
+    }
+
+    printf("%lld games, %lld turns, %lld reverts checked: no divergence\n", stats.games, stats.turns, stats.reverts);
+    printf("edge cases: %lld stacked tanks, %lld head-on shots, %lld multi-kills, %lld bases destroyed\n",
+        stats.stacked, stats.headOn, stats.multiKill, stats.baseKill);
+    printf("symmetry pruning: %lld mirrored positions, %lld of %lld joint actions pruned\n",
+        stats.mirrored, stats.prunedJoints, stats.joints);
+    printf("endings: %lld base destroyed, %lld tanks destroyed, %lld both, %lld turn limit\n",
+        stats.endReason[BaseDestroyed], stats.endReason[TanksDestroyed],
+        stats.endReason[BaseDestroyed | TanksDestroyed], stats.endReason[TurnLimit]);
+    Fuzz::Benchmark();
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Tank2 引擎的 perft 基准
+// 从一个 Botzone 请求（格式同 debug.in 的第一行）恢复局面，用 DoAction / Revert 递归枚举所有合法联合动作，
+// 报告每一层的节点数和每秒节点数：节点数是引擎优化前后的正确性指纹，速度用于追踪模拟器的性能
+// 编译：g++ -O2 -std=c++11 -o tank2_perft tank2_perft.cpp
+// 用法：tank2_perft <层数> [请求文件] [-u] [-s]
+//   请求文件缺省时从标准输入读取；-u 表示剪掉打不到东西的重复射击（见 PruneUselessShots），
+//   -s 表示左右对称的局面里只走互为镜像的联合动作中的一个（见 PruneSymmetric）
+//   已炸的坦克总是只取 Stay；游戏结束的局面计为叶子，不再展开
+
+#define TANK2_NO_MAIN
+#include "tank2_FSM.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+namespace Perft
+{
+    using namespace TankGame;
+
+    struct Counter
+    {
+        // 第 depth 层的节点数（含提前结束的对局）
+        unsigned long long leaves = 0;
+
+        // 叶子局面哈希之和，与枚举顺序无关，比节点数更强的指纹
+        unsigned long long leafHashSum = 0;
+
+        // 调用 DoAction 的次数
+        unsigned long long moves = 0;
+    };
+
+    int pruning = PruneDeadTanks;
+
+    void Search(TankField& f, int depth, Counter& counter)
+    {
+        if (depth == 0 || f.GetGameResult() != NotFinished)
+        {
+            counter.leaves++;
+            counter.leafHashSum += f.hash;
+            return;
+        }
+
+        unsigned short masks[sideCount][tankPerSide];
+        ActionSymmetry symmetry;
+        f.GetLegalActionMasks(masks, pruning, &symmetry);
+        JointActionIterator it(masks, &symmetry);
+        JointAction joint;
+        while (it.Next(joint))
+        {
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    f.nextAction[side][tank] = joint.act[side][tank];
+            if (!f.DoAction())
+            {
+                cout << "DoAction rejected a legal joint action at turn " << f.currentTurn << endl;
+                exit(1);
+            }
+            counter.moves++;
+            Search(f, depth - 1, counter);
+            f.Revert();
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace TankGame;
+
+    if (argc < 2)
+    {
+        cout << "usage: " << argv[0] << " <depth> [request file] [-u] [-s]" << endl;
+        return 1;
+    }
+    int maxDepth = atoi(argv[1]);
+    const char* path = nullptr;
+    for (int i = 2; i < argc; i++)
+    {
+        if (string(argv[i]) == "-u")
+            Perft::pruning |= PruneUselessShots;
+        else if (string(argv[i]) == "-s")
+            Perft::pruning |= PruneSymmetric;
+        else
+            path = argv[i];
+    }
+
+    GameContext game;
+    string data, globalData;
+    if (path)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            cout << "cannot open " << path << endl;
+            return 1;
+        }
+        ReadInput(game, in, data, globalData);
+    }
+    else
+        ReadInput(game, cin, data, globalData);
+    if (!game.field)
+    {
+        cout << "no map in the request" << endl;
+        return 1;
+    }
+
+    game.field->DebugPrint();
+    printf("%5s %16s %18s %16s %10s %14s\n", "depth", "leaves", "leaf hash sum", "DoAction", "seconds", "nodes/s");
+    for (int depth = 1; depth <= maxDepth; depth++)
+    {
+        Perft::Counter counter;
+        auto start = std::chrono::steady_clock::now();
+        Perft::Search(*game.field, depth, counter);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%5d %16llu  %016llx %16llu %10.3f %14.0f\n", depth, counter.leaves, counter.leafHashSum,
+            counter.moves, seconds, seconds > 0 ? counter.moves / seconds : 0.0);
+    }
+    return 0;
+}
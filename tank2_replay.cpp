@@ -0,0 +1,419 @@
+// Tank2 对局日志的批量重放
+// 日志为 JSONL：每行一局，格式同 debug.in 的第一行（requests 的第一项是场地，之后是对方每回合的动作，responses 是我方的动作）
+// 每行用专门的扫描器直接取出场地和动作（不构造 Json::Value），在 TankField 上逐回合重建局面，
+// 并让 HeadQuarter 在每个回合给出它的决策，统计与日志中我方实际动作的一致率
+// 多个线程各自取行处理，互不共享场地和 AI（见 GameContext）
+// 编译：g++ -O2 -std=c++11 -pthread -o tank2_replay tank2_replay.cpp
+// 用法：tank2_replay <日志文件> [-t 线程数] [-c] [-s]
+//   线程数缺省为 CPU 核数；-c 表示同时用 ReadInput（jsoncpp）解析每一行，检查两条路径重建的最终局面相同
+//   -s 表示只重建局面、不运行 HeadQuarter，用于测量重放本身的速度
+//   没有场地的行（如长时运行时的后续请求）和无法解析的行计入 skipped
+
+#define TANK2_NO_MAIN
+#include "tank2_FSM.cpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace Replay
+{
+    using namespace TankGame;
+
+    // 一方的两个坦克在一个回合的动作
+    struct SideAction
+    {
+        Action act[tankPerSide];
+    };
+
+    // 一局的场地和每回合的双方动作
+    struct GameLog
+    {
+        int hasBrick[3], hasWater[3], hasSteel[3];
+        int mySide;
+
+        // requests[1..] 和 responses，各为一个回合
+        vector<SideAction> theirs, mine;
+    };
+
+    // 只认识 Botzone 日志所需的那部分 JSON：整数、整数数组和对象，其余的值整段跳过
+    // 出错时返回 false，不抛异常
+    class Scanner
+    {
+    public:
+        Scanner(const char* begin, const char* end) : p(begin), end(end)
+        {
+        }
+
+        bool ParseGame(GameLog& game)
+        {
+            bool hasMap = false, hasResponses = false;
+            game.theirs.clear();
+            game.mine.clear();
+            if (!_accept('{'))
+                return false;
+            if (_peek('}'))
+                return false;
+            do
+            {
+                string key;
+                if (!_string(&key) || !_accept(':'))
+                    return false;
+                if (key == "requests")
+                {
+                    if (!_requests(game, hasMap))
+                        return false;
+                }
+                else if (key == "responses")
+                {
+                    if (!_actionList(game.mine))
+                        return false;
+                    hasResponses = true;
+                }
+                else if (!_skipValue())
+                    return false;
+            } while (_accept(','));
+            return _accept('}') && hasMap && hasResponses;
+        }
+
+    private:
+        const char* p;
+        const char* end;
+
+        void _skipSpace()
+        {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+                p++;
+        }
+
+        bool _peek(char c)
+        {
+            _skipSpace();
+            return p < end && *p == c;
+        }
+
+        bool _accept(char c)
+        {
+            if (!_peek(c))
+                return false;
+            p++;
+            return true;
+        }
+
+        // key 为空时只跳过
+        bool _string(string* key)
+        {
+            if (!_accept('"'))
+                return false;
+            const char* begin = p;
+            while (p < end && *p != '"')
+                p += *p == '\\' ? 2 : 1;
+            if (p >= end)
+                return false;
+            if (key)
+                key->assign(begin, p);
+            p++;
+            return true;
+        }
+
+        bool _int(int& value)
+        {
+            _skipSpace();
+            bool negative = p < end && *p == '-';
+            if (negative)
+                p++;
+            if (p >= end || *p < '0' || *p > '9')
+                return false;
+            long long v = 0;
+            while (p < end && *p >= '0' && *p <= '9')
+                v = v * 10 + (*p++ - '0');
+            value = (int)(negative ? -v : v);
+            return true;
+        }
+
+        bool _intArray(int* values, int count)
+        {
+            if (!_accept('['))
+                return false;
+            for (int i = 0; i < count; i++)
+                if ((i && !_accept(',')) || !_int(values[i]))
+                    return false;
+            return _accept(']');
+        }
+
+        // [a, b] 形式的一方动作
+        bool _action(SideAction& action)
+        {
+            int act[tankPerSide];
+            if (!_intArray(act, tankPerSide))
+                return false;
+            for (int tank = 0; tank < tankPerSide; tank++)
+            {
+                if (act[tank] < Stay || act[tank] > LeftShoot)
+                    return false;
+                action.act[tank] = (Action)act[tank];
+            }
+            return true;
+        }
+
+        bool _actionList(vector<SideAction>& turns)
+        {
+            if (!_accept('['))
+                return false;
+            if (_accept(']'))
+                return true;
+            do
+            {
+                turns.push_back(SideAction());
+                if (!_action(turns.back()))
+                    return false;
+            } while (_accept(','));
+            return _accept(']');
+        }
+
+        bool _field(GameLog& game)
+        {
+            bool seen[4] = {};
+            if (!_accept('{'))
+                return false;
+            do
+            {
+                string key;
+                if (!_string(&key) || !_accept(':'))
+                    return false;
+                if (key == "brickfield")
+                    seen[0] = _intArray(game.hasBrick, 3);
+                else if (key == "waterfield")
+                    seen[1] = _intArray(game.hasWater, 3);
+                else if (key == "steelfield")
+                    seen[2] = _intArray(game.hasSteel, 3);
+                else if (key == "mySide")
+                    seen[3] = _int(game.mySide) && (game.mySide == Blue || game.mySide == Red);
+                else if (!_skipValue())
+                    return false;
+            } while (_accept(','));
+            return _accept('}') && seen[0] && seen[1] && seen[2] && seen[3];
+        }
+
+        bool _requests(GameLog& game, bool& hasMap)
+        {
+            if (!_accept('[') || !_peek('{') || !_field(game))
+                return false;
+            hasMap = true;
+            while (_accept(','))
+            {
+                game.theirs.push_back(SideAction());
+                if (!_action(game.theirs.back()))
+                    return false;
+            }
+            return _accept(']');
+        }
+
+        bool _skipValue()
+        {
+            _skipSpace();
+            if (p >= end)
+                return false;
+            if (*p == '"')
+                return _string(nullptr);
+            if (*p == '[' || *p == '{')
+            {
+                char close = *p == '[' ? ']' : '}';
+                p++;
+                if (_accept(close))
+                    return true;
+                do
+                {
+                    if (close == '}' && (!_string(nullptr) || !_accept(':')))
+                        return false;
+                    if (!_skipValue())
+                        return false;
+                } while (_accept(','));
+                return _accept(close);
+            }
+            // 数字、true、false、null
+            const char* begin = p;
+            while (p < end && *p != ',' && *p != ']' && *p != '}' && *p != ' ' && *p != '\n')
+                p++;
+            return p > begin;
+        }
+    };
+
+    // 一局的完整回合数：第 t 回合我方动作为 responses[t - 1]，对方动作为 requests[t]
+    inline int TurnCount(const GameLog& game)
+    {
+        return (int)std::min(game.theirs.size(), game.mine.size());
+    }
+
+    // 在 field 上重建整局，每回合执行前调用 visit(我方动作, 对方动作)，此时 field 为该回合开始时的局面
+    // 遇到不合法的联合动作时停下并返回 false
+    template<typename Visitor>
+    bool ReplayGame(const GameLog& game, TankField& field, Visitor visit)
+    {
+        int me = game.mySide, them = 1 - game.mySide;
+        for (int turn = 0; turn < TurnCount(game); turn++)
+        {
+            const SideAction &mine = game.mine[turn], &theirs = game.theirs[turn];
+            visit(mine, theirs);
+            for (int tank = 0; tank < tankPerSide; tank++)
+            {
+                field.nextAction[me][tank] = mine.act[tank];
+                field.nextAction[them][tank] = theirs.act[tank];
+            }
+            if (!field.DoAction())
+                return false;
+        }
+        return true;
+    }
+
+    struct Stats
+    {
+        long long games = 0, skipped = 0, turns = 0, illegal = 0;
+
+        // HeadQuarter 的决策与日志中我方动作相同的坦克-回合数
+        long long agreed = 0;
+
+        // 用 -c 检查时两条路径结果不同的行数
+        long long mismatched = 0;
+
+        void Add(const Stats& b)
+        {
+            games += b.games;
+            skipped += b.skipped;
+            turns += b.turns;
+            illegal += b.illegal;
+            agreed += b.agreed;
+            mismatched += b.mismatched;
+        }
+    };
+
+    struct Line
+    {
+        const char* begin;
+        const char* end;
+    };
+
+    struct Options
+    {
+        bool check = false, statesOnly = false;
+    };
+
+    void Worker(const vector<Line>& lines, std::atomic<size_t>& next, Options options, Stats& stats)
+    {
+        GameLog game;
+        for (size_t i; (i = next.fetch_add(1)) < lines.size();)
+        {
+            Scanner scanner(lines[i].begin, lines[i].end);
+            if (!scanner.ParseGame(game))
+            {
+                stats.skipped++;
+                continue;
+            }
+            stats.games++;
+
+            TankField field(game.hasBrick, game.hasWater, game.hasSteel, game.mySide);
+            HeadQuarter hq;
+            hq.field = &field;
+            hq.mySide = game.mySide;
+            hq.rng.seed((unsigned)i); // 按行号播种，结果与线程数无关、可以复现
+            bool legal = ReplayGame(game, field, [&](const SideAction& mine, const SideAction&)
+            {
+                if (!options.statesOnly)
+                    for (int tank = 0; tank < tankPerSide; tank++)
+                        stats.agreed += hq.takeAction(tank) == mine.act[tank];
+                stats.turns++;
+            });
+            stats.illegal += !legal;
+
+            if (options.check)
+            {
+                // ReadInput 在最后一个请求之前停下，与这里重建到的回合相同
+                GameContext context;
+                std::istringstream in(string(lines[i].begin, lines[i].end));
+                string data, globalData;
+                ReadInput(context, in, data, globalData);
+                if (!context.field || *context.field != field)
+                    stats.mismatched++;
+            }
+        }
+    }
+
+    double Seconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace Replay;
+
+    const char* path = nullptr;
+    int threadCount = (int)std::thread::hardware_concurrency();
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "-c")
+            options.check = true;
+        else if (arg == "-s")
+            options.statesOnly = true;
+        else if (arg == "-t" && i + 1 < argc)
+            threadCount = atoi(argv[++i]);
+        else
+            path = argv[i];
+    }
+    if (!path)
+    {
+        cout << "usage: " << argv[0] << " <log file> [-t threads] [-c] [-s]" << endl;
+        return 1;
+    }
+    if (threadCount < 1)
+        threadCount = 1;
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        cout << "cannot open " << path << endl;
+        return 1;
+    }
+    string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    vector<Line> lines;
+    for (const char *p = text.data(), *end = p + text.size(); p < end;)
+    {
+        const char* eol = (const char*)memchr(p, '\n', end - p);
+        if (!eol)
+            eol = end;
+        if (eol > p)
+            lines.push_back({ p, eol });
+        p = eol + 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    vector<Stats> stats(threadCount);
+    vector<std::thread> threads;
+    std::atomic<size_t> next(0);
+    for (int t = 0; t < threadCount; t++)
+        threads.emplace_back(Worker, std::cref(lines), std::ref(next), options, std::ref(stats[t]));
+    for (auto& thread : threads)
+        thread.join();
+    double seconds = Seconds(start);
+
+    Stats total;
+    for (auto& s : stats)
+        total.Add(s);
+    printf("%lld games, %lld skipped lines, %lld turns on %d threads in %.3f s (%.0f games/s, %.0f turns/s)\n",
+        total.games, total.skipped, total.turns, threadCount, seconds, total.games / seconds, total.turns / seconds);
+    if (!options.statesOnly)
+        printf("HeadQuarter agrees with the logged action on %lld of %lld tank-turns (%.1f%%)\n",
+            total.agreed, total.turns * tankPerSide, total.turns ? 100.0 * total.agreed / (total.turns * tankPerSide) : 0.0);
+    if (total.illegal)
+        printf("%lld games stopped early at an illegal joint action\n", total.illegal);
+    if (options.check)
+        printf("ReadInput cross-check: %lld mismatched games\n", total.mismatched);
+    return total.mismatched ? 1 : 0;
+}